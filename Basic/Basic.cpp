@@ -6,11 +6,22 @@
 
 
 #include <cctype>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
+#include "cfg.hpp"
 #include "exp.hpp"
 #include "parser.hpp"
 #include "program.hpp"
+#include "stackvm.hpp"
+#include "regvm.hpp"
+#include "jit.hpp"
+#include "keyword.hpp"
+#include "lexer.hpp"
+#include "tiered.hpp"
+#include "transpiler.hpp"
 #include "Utils/error.hpp"
 #include "Utils/tokenScanner.hpp"
 #include "Utils/strlib.hpp"
@@ -19,12 +30,22 @@
 /* Function prototypes */
 
 void processLine(std::string line, Program &program, EvalState &state);
+bool loadProgram(const std::string &filename, Program &program);
 
 /* Main program */
 
-int main() {
+int main(int argc, char **argv) {
     EvalState state;
     Program program;
+    if (argc > 1) {
+        if (argc != 3 || std::string(argv[1]) != "--emit-cpp") {
+            std::cerr << "usage: " << argv[0] << " [--emit-cpp file]" << std::endl;
+            return 2;
+        }
+        if (!loadProgram(argv[2], program)) return 1;
+        emitCpp(program, std::cout);
+        return 0;
+    }
     //cout << "Stub implementation of BASIC" << endl;
     while (true) {
         try {
@@ -40,6 +61,50 @@ int main() {
     return 0;
 }
 
+/*
+ * Function: loadProgram
+ * Usage: if (loadProgram(filename, program)) . . .
+ * ------------------------------------------------
+ * Stores every numbered line of the file in program, as if it had been
+ * typed at the prompt.  The whole file is read and lexed at once, and
+ * each line is then parsed from its tokens.  Blank lines are skipped.
+ * Any other line, or a line that does not parse, is reported on
+ * std::cerr together with its row and the column of the token at which
+ * the problem was found, and the function returns false.
+ */
+
+bool loadProgram(const std::string &filename, Program &program) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        std::cerr << filename << ": cannot open file" << std::endl;
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+    std::vector<SourceToken> tokens;
+    std::vector<SourceLine> lines;
+    TokenScanner scanner;
+    int row = 0;
+    try {
+        lexSource(text, tokens, lines);
+        for (const SourceLine &line : lines) {
+            row++;
+            if (line.tokenCount == 0) continue;
+            std::string_view source = std::string_view(text).substr(line.offset, line.length);
+            scanner.setInputTokens(source, &tokens[line.firstToken], line.tokenCount);
+            std::string_view token = scanner.nextTokenView();
+            if (scanner.getTokenType(token) != NUMBER || !scanner.hasMoreTokens()) error("SYNTAX ERROR");
+            program.addSourceLine(parseIntegerLiteral(token), source, scanner);
+        }
+    } catch (ErrorException &ex) {
+        std::cerr << filename << ":" << row << ":" << scanner.getTokenSpan().offset + 1 << ": "
+                  << ex.getMessage() << std::endl;
+        return false;
+    }
+    return true;
+}
+
 /*
  * Function: processLine
  * Usage: processLine(line, program, state);
@@ -58,9 +123,10 @@ void processLine(std::string line, Program &program, EvalState &state) {
     TokenScanner scanner;
     scanner.ignoreWhitespace();
     scanner.scanNumbers();
-    scanner.setInput(line);
+    scanner.setInputView(line);
 
-    std::string m = scanner.nextToken();
+    std::string_view m = scanner.nextTokenView();
+    if (m.empty()) return;
     bool flag = true;
     for (char i : m){
         if (!isdigit(i)) {
@@ -69,102 +135,64 @@ void processLine(std::string line, Program &program, EvalState &state) {
         }
     }
     if (flag){
-        int lineNumber = stoi(m);
+        int lineNumber = parseIntegerLiteral(m);
         if (!scanner.hasMoreTokens()) {
             program.removeSourceLine(lineNumber);
         }
         else{
-            m = scanner.nextToken();program.addSourceLine(lineNumber,line);
-            /*if (m == "REM") ;
-            else if (m == "LET") {
-
-            }
-            else if (m == "PRINT") {
-
-            }
-            else if (m == "INPUT") {
-
-            }
-            else if (m == "END") {
-
-            }
-            else if (m == "GOTO") {
-
-            }
-            else if (m == "IF") {
-
-            }*/
+            program.addSourceLine(lineNumber, line);
         }
     }
     else{
-        if (m == "QUIT") exit(0);
-        else if (m == "LIST") {
-            program.PrintLines();
-        }
-        else if (m == "CLEAR") {
-            program.clear();
-            state.Clear();
-        }
-        else if (m == "HELP") {std::cout<<"\n";}
-        else if (m == "LET") {
-            std::string var=scanner.nextToken();
-            if (var == "LET") {
-                std::cout<<"SYNTAX ERROR\n";
-                return;
-            }
-            scanner.nextToken();
-            auto w = readE(scanner);
-            try{
-                state.setValue(var,w->eval(state));
-                delete w;
-            }
-            catch (ErrorException &ex) {
-                delete w;
-                std::cout << ex.getMessage() << std::endl;
-            }
-        }
-        else if (m == "PRINT") {
-            auto w = readE(scanner);
-            try{
-                std::cout << w->eval(state) << '\n';
-                delete w;
-            }
-            catch (ErrorException &ex) {
-                delete w;
-                std::cout << ex.getMessage() << std::endl;
+        switch (lookupKeyword(m)) {
+            case QUIT_KW:
+                exit(0);
+            case LIST_KW:
+                program.PrintLines();
+                break;
+            case CLEAR_KW:
+                program.clear();
+                state.Clear();
+                EvalState::clearNames();
+                break;
+            case HELP_KW:
+                std::cout<<"\n";
+                break;
+            case LET_KW:
+            case PRINT_KW:
+            case INPUT_KW: {
+                static Arena scratch;           /* Reused by every command */
+                scratch.reset();
+                scanner.saveToken(m);
+                parseStatement(scanner, scratch)->execute(state, program);
+                break;
             }
-        }
-        else if (m == "INPUT") {
-            std::string var=scanner.nextToken();
-            while(true){
-                std::cout << " ? ";
-                std::string num;
-                getline(std::cin,num);
-                bool flag2= true;
-                if (!(isdigit(num[0])||num[0]=='-')){
-                    std::cout << "INVALID NUMBER\n";
-                    continue;
+            case RUN_KW: {
+                std::string mode = scanner.nextToken();
+                if (mode.empty()) runTiered(program, state);
+                else if (mode == "STACK") {
+                    StackVM vm(program);
+                    vm.run(state);
                 }
-                for (int i = 1; i<num.length();i++) {
-                    if (!isdigit(num[i])){
-                        flag2=false;
-                        break;
-                    }
+                else if (mode == "REGISTER") {
+                    RegisterVM vm(program);
+                    vm.run(state);
                 }
-                if (!flag2) {
-                    std::cout << "INVALID NUMBER\n";
-                    continue;
+                else if (mode == "JIT") {
+                    NativeCode native(program);
+                    if (native.isCompiled()) native.run(state, program);
+                    else {
+                        RegisterVM vm(program);
+                        vm.run(state);
+                    }
                 }
-                int num2=std::stoi(num);
-                state.setValue(var,num2);
+                else if (mode == "TREE") program.Run(program,state);
+                else error("SYNTAX ERROR");
                 break;
             }
-        }
-        else if (m == "RUN") {
-            program.Run(program,state);
-        }
-        else {
-            error("SYNTAX ERROR");
+            default:
+                if (m == "CFG") program.getControlFlowGraph().print(std::cout);
+                else error("SYNTAX ERROR");
         }
     }
 }
@@ -5,6 +5,7 @@
  */
 
 #include <cctype>
+#include <charconv>
 #include <iomanip>
 #include <iostream>
 #include "error.hpp"
@@ -24,14 +25,39 @@ std::string integerToString(int n) {
     return stream.str();
 }
 
-int stringToInteger(std::string str) {
+/*
+ * Implementation notes: parseInteger, stringToInteger
+ * ---------------------------------------------------
+ * Integers are parsed with std::from_chars, which neither allocates nor
+ * depends on the locale, and which reports overflow instead of wrapping.
+ * stringToInteger keeps the rules of the stream extraction it replaces
+ * by first trimming whitespace and a leading plus sign.
+ */
 
-    std::istringstream stream(str);
-    int value;
-    stream >> value;
-    if (!stream.eof()) stream >> std::ws;
-    if (stream.fail() || !stream.eof()) {
-        error("stringToInteger: Illegal integer format (" + str + ")");
+IntegerStatus parseInteger(std::string_view str, int &value) {
+    int result;
+    auto [end, ec] = std::from_chars(str.data(), str.data() + str.length(), result);
+    if (ec == std::errc::result_out_of_range) return INTEGER_OUT_OF_RANGE;
+    if (ec != std::errc() || end != str.data() + str.length()) return INTEGER_INVALID;
+    value = result;
+    return INTEGER_OK;
+}
+
+int stringToInteger(std::string_view str) {
+    std::string_view digits = str;
+    while (!digits.empty() && isspace((unsigned char) digits.front())) digits.remove_prefix(1);
+    while (!digits.empty() && isspace((unsigned char) digits.back())) digits.remove_suffix(1);
+    if (digits.length() > 1 && digits[0] == '+' && isdigit((unsigned char) digits[1])) digits.remove_prefix(1);
+    int value = 0;
+    switch (parseInteger(digits, value)) {
+        case INTEGER_OK:
+            break;
+        case INTEGER_INVALID:
+            error("stringToInteger: Illegal integer format (" + std::string(str) + ")");
+            break;
+        case INTEGER_OUT_OF_RANGE:
+            error("stringToInteger: Integer out of range (" + std::string(str) + ")");
+            break;
     }
     return value;
 }
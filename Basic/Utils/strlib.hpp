@@ -10,6 +10,7 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 
 /*
  * Function: integerToString
@@ -22,6 +23,29 @@
 
 std::string integerToString(int n);
 
+/*
+ * Type: IntegerStatus
+ * -------------------
+ * The outcome of <code>parseInteger</code>.
+ */
+
+enum IntegerStatus {
+    INTEGER_OK, INTEGER_INVALID, INTEGER_OUT_OF_RANGE
+};
+
+/*
+ * Function: parseInteger
+ * Usage: IntegerStatus status = parseInteger(str, value);
+ * -------------------------------------------------------
+ * Converts str, which must consist of an optional minus sign followed
+ * by one or more digits and nothing else, into an int stored in value.
+ * Returns <code>INTEGER_INVALID</code> if str does not have that form
+ * and <code>INTEGER_OUT_OF_RANGE</code> if its value does not fit in an
+ * int; value is unchanged in both cases.  No memory is allocated.
+ */
+
+IntegerStatus parseInteger(std::string_view str, int &value);
+
 /*
  * Function: stringToInteger
  * Usage: int n = stringToInteger(str);
@@ -29,10 +53,10 @@ std::string integerToString(int n);
  * Converts a string of digits into an integer.  If the string is not a
  * legal integer or contains extraneous characters other than whitespace,
  * <code>stringToInteger</code> calls <code>error</code> with an
- * appropriate message.
+ * appropriate message, which says so if the value is out of range.
  */
 
-int stringToInteger(std::string str);
+int stringToInteger(std::string_view str);
 
 /*
  * Function: realToString
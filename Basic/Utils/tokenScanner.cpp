@@ -9,6 +9,20 @@
 #include "tokenScanner.hpp"
 #include "strlib.hpp"
 
+/*
+ * Implementation notes: DEFAULT_CLASSES, BASIC_OPERATORS
+ * ------------------------------------------------------
+ * The default classes agree with isspace, isdigit and isalnum in the C
+ * locale.  The operators are those of BASIC.  All of them are single
+ * characters, which the scanner would return as one-character tokens
+ * anyway, so the trie changes no token; longer operators added later
+ * simply extend it.
+ */
+
+constexpr TokenScanner::ClassTable TokenScanner::DEFAULT_CLASSES = makeClassTable();
+
+constexpr TokenScanner::OperatorTrie TokenScanner::BASIC_OPERATORS =
+        makeOperatorTrie({"+", "-", "*", "/", "=", "<", ">", "(", ")"});
 
 TokenScanner::TokenScanner() {
     initScanner();
@@ -25,108 +39,195 @@ TokenScanner::TokenScanner(std::istream &infile) {
     setInput(infile);
 }
 
-TokenScanner::~TokenScanner() {
-    delete isp;
-    //delete savedTokens chain
-    StringCell *pre = savedTokens;
-    while (savedTokens) {
-        savedTokens = savedTokens->link;
-        delete pre;
-        pre = savedTokens;
-    }
-    //delete operators chain
-    StringCell *p = operators;
-    while (operators) {
-        operators = operators->link;
-        delete p;
-        p = operators;
-    }
-}
+TokenScanner::~TokenScanner() = default;
+
+/*
+ * Implementation notes: setInput, setInputView
+ * --------------------------------------------
+ * A string input is scanned in place through view, with cursor marking
+ * the next character, so no stream object is ever allocated for it.
+ * setInput keeps its own copy of the string for the view to refer to;
+ * setInputView refers to the caller's characters directly.  Only an
+ * input stream is read through isp.  setInputTokens is a string input
+ * whose tokens are already known; the scanner still keeps start and
+ * cursor at the bounds of the last token so that the rest of the class
+ * need not distinguish the two.
+ */
 
 void TokenScanner::setInput(std::string str) {
-    buffer = str;
-    if (isp != nullptr) delete isp;
-    isp = new std::istringstream(buffer);
-    delete savedTokens;
-    savedTokens = nullptr;
+    buffer = std::move(str);
+    setInputView(buffer);
 }
 
 void TokenScanner::setInput(std::istream &infile) {
-    if (isp != nullptr)delete isp;
+    setInputView(std::string_view());
     isp = &infile;
-    delete savedTokens;
-    savedTokens = nullptr;
+}
+
+void TokenScanner::setInputView(std::string_view str) {
+    isp = nullptr;
+    tokens = nullptr;
+    view = str;
+    rewind(0, 1, 0);
+    start = spanStart = startLineStart = 0;
+    startLine = 1;
+    span = {1, 0, 0};
+    savedCount = 0;
+}
+
+void TokenScanner::setInputTokens(std::string_view str, const SourceToken *tokens, size_t count) {
+    setInputView(str);
+    this->tokens = tokens;
+    tokenCount = count;
+    tokenIndex = 0;
 }
 
 bool TokenScanner::hasMoreTokens() {
-    std::string token = nextToken();
-    saveToken(token);
-    return (token != "");
+    return !peekToken().empty();
 }
 
 std::string TokenScanner::nextToken() {
-    if (savedTokens != nullptr) {
-        StringCell *cp = savedTokens;
-        std::string token = cp->str;
-        savedTokens = cp->link;
-        delete cp;
-        return token;
+    return std::string(nextTokenView());
+}
+
+/*
+ * Implementation notes: nextTokenView
+ * -----------------------------------
+ * The scanning functions only move the cursor.  Whatever lies between
+ * start and the cursor when they stop is the token, so for a string
+ * input it can be returned as a slice of the input.  finishToken also
+ * records the span of the token, from the line that was current when
+ * the token started.
+ */
+
+std::string_view TokenScanner::nextTokenView() {
+    if (savedCount > 0) {
+        SavedToken &entry = saved[savedHead];
+        current.swap(entry.text);
+        span = entry.span;
+        spanStart = entry.position;
+        savedHead = (savedHead + 1) % MAX_SAVED_TOKENS;
+        savedCount--;
+        return current;
+    }
+    if (tokens != nullptr) {
+        if (tokenIndex == tokenCount) {
+            start = cursor = view.length();
+            return finishToken();
+        }
+        const SourceToken &token = tokens[tokenIndex++];
+        start = token.offset;
+        cursor = token.offset + token.length;
+        return finishToken();
     }
     while (true) {
         if (ignoreWhitespaceFlag) skipSpaces();
-        int ch = isp->get();
+        current.clear();
+        start = cursor;
+        startLine = line;
+        startLineStart = lineStart;
+        int ch = get();
         if (ch == '/' && ignoreCommentsFlag) {
-            ch = isp->get();
+            ch = get();
             if (ch == '/') {
                 while (true) {
-                    ch = isp->get();
+                    ch = get();
                     if (ch == '\n' || ch == '\r' || ch == EOF) break;
                 }
                 continue;
             } else if (ch == '*') {
                 int prev = EOF;
                 while (true) {
-                    ch = isp->get();
+                    ch = get();
                     if (ch == EOF || (prev == '*' && ch == '/')) break;
                     prev = ch;
                 }
                 continue;
             }
-            if (ch != EOF) isp->unget();
+            if (ch != EOF) unget();
             ch = '/';
         }
-        if (ch == EOF) return "";
-        if ((ch == '"' || ch == '\'') && scanStringsFlag) {
-            isp->unget();
-            return scanString();
-        }
-        if (isdigit(ch) && scanNumbersFlag) {
-            isp->unget();
-            return scanNumber();
+        if (ch == EOF) return finishToken();
+        if (isClass(ch, QUOTE_CLASS) && scanStringsFlag) {
+            unget();
+            scanString();
+            return finishToken();
         }
-        if (isWordCharacter(ch)) {
-            isp->unget();
-            return scanWord();
+        if (isClass(ch, DIGIT_CLASS) && scanNumbersFlag) {
+            unget();
+            scanNumber();
+            return finishToken();
         }
-        std::string op = std::string(1, ch);
-        while (isOperatorPrefix(op)) {
-            ch = isp->get();
-            if (ch == EOF) break;
-            op += ch;
+        if (isClass(ch, WORD_CLASS)) {
+            unget();
+            scanWord();
+            return finishToken();
         }
-        while (op.length() > 1 && !isOperator(op)) {
-            isp->unget();
-            op.erase(op.length() - 1, 1);
-        }
-        return op;
+        scanOperator(ch);
+        return finishToken();
+    }
+}
+
+/*
+ * Implementation notes: peekToken
+ * -------------------------------
+ * For a string input the scanner can simply remember its position and
+ * come back to it, so looking ahead costs nothing but the scan itself.
+ * A stream cannot be rewound that far, so the token is saved instead.
+ */
+
+std::string_view TokenScanner::peekToken() {
+    if (savedCount > 0) return saved[savedHead].text;
+    if (tokens != nullptr) {
+        if (tokenIndex == tokenCount) return std::string_view();
+        return view.substr(tokens[tokenIndex].offset, tokens[tokenIndex].length);
+    }
+    SourceSpan lastSpan = span;
+    size_t lastStart = spanStart;
+    std::string_view token;
+    if (isp == nullptr) {
+        size_t mark = cursor;
+        int markLine = line;
+        size_t markLineStart = lineStart;
+        token = nextTokenView();
+        rewind(mark, markLine, markLineStart);
+    } else {
+        saveToken(nextTokenView());
+        token = saved[savedHead].text;
     }
+    span = lastSpan;
+    spanStart = lastStart;
+    return token;
 }
 
+/*
+ * Implementation notes: saveToken
+ * -------------------------------
+ * Saved tokens are kept in a fixed ring used as a stack:
+ * saving a token moves savedHead back one slot and the next read takes
+ * the token from savedHead.  The strings are assigned rather than
+ * replaced, and nextTokenView swaps the one it returns with current, so
+ * once their buffers have grown to fit the tokens no pushback allocates.
+ */
+
 void TokenScanner::saveToken(std::string token) {
-    StringCell *cp = new StringCell;
-    cp->str = token;
-    cp->link = savedTokens;
-    savedTokens = cp;
+    saveToken(std::string_view(token));
+}
+
+void TokenScanner::saveToken(std::string_view token) {
+    if (isp == nullptr && savedCount == 0 &&
+        token.data() == view.data() + start && start + token.length() == cursor) {
+        if (tokens != nullptr) tokenIndex--;
+        rewind(start, startLine, startLineStart);
+        return;
+    }
+    if (savedCount == MAX_SAVED_TOKENS) error("TokenScanner: too many saved tokens");
+    savedHead = (savedHead + MAX_SAVED_TOKENS - 1) % MAX_SAVED_TOKENS;
+    SavedToken &entry = saved[savedHead];
+    entry.text.assign(token.data(), token.length());
+    entry.span = span;
+    entry.position = spanStart;
+    savedCount++;
 }
 
 void TokenScanner::ignoreWhitespace() {
@@ -146,27 +247,31 @@ void TokenScanner::scanStrings() {
 }
 
 void TokenScanner::addWordCharacters(std::string str) {
-    wordChars += str;
+    for (char ch : str) classes[(unsigned char) ch] |= WORD_CLASS;
 }
 
 void TokenScanner::addOperator(std::string op) {
-    StringCell *cp = new StringCell;
-    cp->str = op;
-    cp->link = operators;
-    operators = cp;
+    if (!ownOperators) {
+        ownOperators = std::make_unique<OperatorTrie>(*operators);
+        operators = ownOperators.get();
+    }
+    if (!ownOperators->add(op)) error("TokenScanner: too many operators");
 }
 
 int TokenScanner::getPosition() const {
-    if (savedTokens == nullptr) {
-        return int(isp->tellg());
+    if (savedCount == 0) {
+        return int(cursor);
     } else {
-        return int(isp->tellg()) - savedTokens->str.length();
+        return int(saved[savedHead].position);
     }
-    return -1;
+}
+
+SourceSpan TokenScanner::getTokenSpan() const {
+    return span;
 }
 
 bool TokenScanner::isWordCharacter(char ch) const {
-    return isalnum(ch) || wordChars.find(ch) != std::string::npos;
+    return classes[(unsigned char) ch] & WORD_CLASS;
 };
 
 void TokenScanner::verifyToken(std::string expected) {
@@ -178,13 +283,13 @@ void TokenScanner::verifyToken(std::string expected) {
     }
 };
 
-TokenType TokenScanner::getTokenType(std::string token) const {
-    if (token == "") return TokenType(EOF);
-    char ch = token[0];
-    if (isspace(ch)) return SEPARATOR;
+TokenType TokenScanner::getTokenType(std::string_view token) const {
+    if (token.empty()) return TokenType(EOF);
+    unsigned char ch = token[0];
+    if (classes[ch] & SPACE_CLASS) return SEPARATOR;
     if (ch == '"' || (ch == '\'' && token.length() > 1)) return STRING;
-    if (isdigit(ch)) return NUMBER;
-    if (isWordCharacter(ch)) return WORD;
+    if (classes[ch] & DIGIT_CLASS) return NUMBER;
+    if (classes[ch] & WORD_CLASS) return WORD;
     return OPERATOR;
 };
 
@@ -264,11 +369,11 @@ std::string TokenScanner::getStringValue(std::string token) const {
 }
 
 int TokenScanner::getChar() {
-    return isp->get();
+    return get();
 }
 
 void TokenScanner::ungetChar(int ch) {
-    isp->unget();
+    unget();
 }
 
 /* Private methods */
@@ -278,7 +383,81 @@ void TokenScanner::initScanner() {
     ignoreCommentsFlag = false;
     scanNumbersFlag = false;
     scanStringsFlag = false;
-    operators = nullptr;
+    classes = DEFAULT_CLASSES;
+    operators = &BASIC_OPERATORS;
+}
+
+/*
+ * Implementation notes: get, unget, token
+ * ---------------------------------------
+ * All reading goes through get and unget, which move the cursor and
+ * keep track of the line it is on.  For a stream they also keep the
+ * characters read since the start of the current token in current,
+ * since those cannot be read again later; a stream that has just hit
+ * its end must be cleared before a character can be put back.  When
+ * current is empty the last get found the end, so there is nothing to
+ * put back, and neither the stream nor the cursor moves.  No more
+ * than one newline is ever put back in a row, so remembering where the
+ * previous line began is enough to undo reading one.
+ */
+
+int TokenScanner::get() {
+    int ch;
+    if (isp != nullptr) {
+        ch = isp->get();
+        if (ch == EOF) return EOF;
+        current += char(ch);
+        cursor++;
+    } else {
+        if (cursor >= view.length()) return EOF;
+        ch = (unsigned char) view[cursor++];
+    }
+    if (ch == '\n') {
+        line++;
+        prevLineStart = lineStart;
+        lineStart = cursor;
+    }
+    return ch;
+}
+
+void TokenScanner::unget() {
+    char ch;
+    if (isp != nullptr) {
+        if (current.empty()) return;
+        if (isp->eof()) isp->clear();
+        isp->unget();
+        ch = current.back();
+        current.pop_back();
+        cursor--;
+    } else {
+        ch = view[--cursor];
+    }
+    if (ch == '\n') {
+        line--;
+        lineStart = prevLineStart;
+    }
+}
+
+void TokenScanner::rewind(size_t position, int line, size_t lineStart) {
+    cursor = position;
+    this->line = line;
+    this->lineStart = lineStart;
+}
+
+std::string_view TokenScanner::token() const {
+    if (isp != nullptr) return current;
+    if (tokens != nullptr && start == view.length()) return std::string_view();
+    return view.substr(start, cursor - start);
+}
+
+std::string_view TokenScanner::finishToken() {
+    span = {startLine, int(start - startLineStart), int(cursor - start)};
+    spanStart = start;
+    return token();
+}
+
+bool TokenScanner::isClass(int ch, unsigned char bits) const {
+    return ch != EOF && (classes[ch] & bits);
 }
 
 /*
@@ -290,10 +469,10 @@ void TokenScanner::initScanner() {
 
 void TokenScanner::skipSpaces() {
     while (true) {
-        int ch = isp->get();
+        int ch = get();
         if (ch == EOF) return;
-        if (!isspace(ch)) {
-            isp->unget();
+        if (!(classes[ch] & SPACE_CLASS)) {
+            unget();
             return;
         }
     }
@@ -306,18 +485,15 @@ void TokenScanner::skipSpaces() {
  * of word characters.
  */
 
-std::string TokenScanner::scanWord() {
-    std::string token = "";
+void TokenScanner::scanWord() {
     while (true) {
-        int ch = isp->get();
+        int ch = get();
         if (ch == EOF) break;
-        if (!isWordCharacter(ch)) {
-            isp->unget();
+        if (!(classes[ch] & WORD_CLASS)) {
+            unget();
             break;
         }
-        token += char(ch);
     }
-    return token;
 }
 
 /*
@@ -330,15 +506,14 @@ std::string TokenScanner::scanWord() {
  * determine what characters would be legal at this point in time.
  */
 
-std::string TokenScanner::scanNumber() {
-    std::string token = "";
+void TokenScanner::scanNumber() {
     NumberScannerState state = INITIAL_STATE;
     while (state != FINAL_STATE) {
-        int ch = isp->get();
+        int ch = get();
         int xch = 'e';
         switch (state) {
             case INITIAL_STATE:
-                if (!isdigit(ch)) {
+                if (!isClass(ch, DIGIT_CLASS)) {
                     error("Internal error: illegal call to scanNumber");
                 }
                 state = BEFORE_DECIMAL_POINT;
@@ -349,8 +524,8 @@ std::string TokenScanner::scanNumber() {
                 } else if (ch == 'E' || ch == 'e') {
                     state = STARTING_EXPONENT;
                     xch = ch;
-                } else if (!isdigit(ch)) {
-                    if (ch != EOF) isp->unget();
+                } else if (!isClass(ch, DIGIT_CLASS)) {
+                    if (ch != EOF) unget();
                     state = FINAL_STATE;
                 }
                 break;
@@ -358,35 +533,35 @@ std::string TokenScanner::scanNumber() {
                 if (ch == 'E' || ch == 'e') {
                     state = STARTING_EXPONENT;
                     xch = ch;
-                } else if (!isdigit(ch)) {
-                    if (ch != EOF) isp->unget();
+                } else if (!isClass(ch, DIGIT_CLASS)) {
+                    if (ch != EOF) unget();
                     state = FINAL_STATE;
                 }
                 break;
             case STARTING_EXPONENT:
                 if (ch == '+' || ch == '-') {
                     state = FOUND_EXPONENT_SIGN;
-                } else if (isdigit(ch)) {
+                } else if (isClass(ch, DIGIT_CLASS)) {
                     state = SCANNING_EXPONENT;
                 } else {
-                    if (ch != EOF) isp->unget();
-                    isp->unget();
+                    if (ch != EOF) unget();
+                    unget();
                     state = FINAL_STATE;
                 }
                 break;
             case FOUND_EXPONENT_SIGN:
-                if (isdigit(ch)) {
+                if (isClass(ch, DIGIT_CLASS)) {
                     state = SCANNING_EXPONENT;
                 } else {
-                    if (ch != EOF) isp->unget();
-                    isp->unget();
-                    isp->unget();
+                    if (ch != EOF) unget();
+                    unget();
+                    unget();
                     state = FINAL_STATE;
                 }
                 break;
             case SCANNING_EXPONENT:
-                if (!isdigit(ch)) {
-                    if (ch != EOF) isp->unget();
+                if (!isClass(ch, DIGIT_CLASS)) {
+                    if (ch != EOF) unget();
                     state = FINAL_STATE;
                 }
                 break;
@@ -394,11 +569,7 @@ std::string TokenScanner::scanNumber() {
                 state = FINAL_STATE;
                 break;
         }
-        if (state != FINAL_STATE) {
-            token += char(ch);
-        }
     }
-    return token;
 }
 
 /*
@@ -409,40 +580,43 @@ std::string TokenScanner::scanNumber() {
  * there is no closing quotation mark before the end of the input.
  */
 
-std::string TokenScanner::scanString() {
-    std::string token = "";
-    char delim = isp->get();
-    token += delim;
+void TokenScanner::scanString() {
+    char delim = get();
     bool escape = false;
     while (true) {
-        int ch = isp->get();
+        int ch = get();
         if (ch == EOF) error("TokenScanner found unterminated string");
         if (ch == delim && !escape) break;
         escape = (ch == '\\') && !escape;
-        token += ch;
     }
-    return token + delim;
 }
 
 /*
- * Implementation notes: isOperator, isOperatorPrefix
- * --------------------------------------------------
- * These methods search the list of operators and return true if the
- * specified operator is either in the list or a prefix of an operator
- * in the list, respectively.  This code could be made considerably more
- * efficient by implementing operators as a trie.
+ * Implementation notes: scanOperator
+ * ----------------------------------
+ * Called with the first character of the token already read.  The
+ * scanner follows the trie as far as the input allows, remembering
+ * where the last complete operator ended, and then backs up to that
+ * point.  If no operator matched, the token is the single character,
+ * whatever it is.
  */
 
-bool TokenScanner::isOperator(std::string op) {
-    for (StringCell *cp = operators; cp != nullptr; cp = cp->link) {
-        if (op == cp->str) return true;
-    }
-    return false;
-}
-
-bool TokenScanner::isOperatorPrefix(std::string op) {
-    for (StringCell *cp = operators; cp != nullptr; cp = cp->link) {
-        if (startsWith(cp->str, op)) return true;
+void TokenScanner::scanOperator(int ch) {
+    int node = operators->step(0, ch);
+    if (node == 0) return;
+    int length = 1;
+    int matched = 1;
+    while (operators->nodes[node].child != 0) {
+        ch = get();
+        if (ch == EOF) break;
+        int next = operators->step(node, ch);
+        if (next == 0) {
+            unget();
+            break;
+        }
+        node = next;
+        length++;
+        if (operators->nodes[node].accepting) matched = length;
     }
-    return false;
+    for (; length > matched; length--) unget();
 }
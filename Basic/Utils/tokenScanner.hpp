@@ -14,9 +14,13 @@
  * a string into individual logical units called <b><i>tokens</i></b>.
  */
 
+#include <array>
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
+#include <memory>
 #include <string>
-#include <sstream>
+#include <string_view>
 
 /*
  * Type: TokenType
@@ -29,6 +33,34 @@ enum TokenType {
     SEPARATOR, WORD, NUMBER, STRING, OPERATOR
 };
 
+/*
+ * Type: SourceToken
+ * -----------------
+ * A token that has already been located in some text, given by its
+ * offset and length in that text and its type.  An array of these can
+ * be read back through a scanner with <code>setInputTokens</code>.
+ */
+
+struct SourceToken {
+    uint32_t offset;
+    uint32_t length;
+    TokenType type;
+};
+
+/*
+ * Type: SourceSpan
+ * ----------------
+ * The place a token came from: the line it is on, counting the first
+ * line of the input as 1, the offset of its first character from the
+ * start of that line, and its length.
+ */
+
+struct SourceSpan {
+    int line;
+    int offset;
+    int length;
+};
+
 /*
  * Class: TokenScanner
  * -------------------
@@ -93,6 +125,31 @@ public:
 
     void setInput(std::istream &infile);
 
+/*
+ * Method: setInputView
+ * Usage: scanner.setInputView(str);
+ * ---------------------------------
+ * Sets the token stream for this scanner to the characters of str
+ * without copying them.  The characters must remain valid, and
+ * unchanged, for as long as the scanner reads from them.  Any previous
+ * token stream is discarded.
+ */
+
+    void setInputView(std::string_view str);
+
+/*
+ * Method: setInputTokens
+ * Usage: scanner.setInputTokens(str, tokens, count);
+ * --------------------------------------------------
+ * Sets the token stream for this scanner to count tokens that have
+ * already been found in str, such as those produced by lexSource.  The
+ * scanner returns them as views of str without scanning str itself, so
+ * its settings have no effect.  Both str and the tokens must remain
+ * valid for as long as the scanner reads from them.
+ */
+
+    void setInputTokens(std::string_view str, const SourceToken *tokens, size_t count);
+
 /*
  * Method: hasMoreTokens
  * Usage: if (scanner.hasMoreTokens()) ...
@@ -113,6 +170,31 @@ public:
 
     std::string nextToken();
 
+/*
+ * Method: nextTokenView
+ * Usage: std::string_view token = scanner.nextTokenView();
+ * --------------------------------------------------------
+ * Returns the next token like <code>nextToken</code>, but as a view
+ * rather than a new string.  When the input was set from a string and
+ * the token was not saved, the view refers directly to the input
+ * characters and stays valid as long as they do.  Otherwise it refers
+ * to storage inside the scanner and is only valid until the next call
+ * that reads from the scanner.
+ */
+
+    std::string_view nextTokenView();
+
+/*
+ * Method: peekToken
+ * Usage: std::string_view token = scanner.peekToken();
+ * ----------------------------------------------------
+ * Returns the token that the next call to <code>nextToken</code> will
+ * return, without consuming it.  The view is valid until the next call
+ * that reads from the scanner.
+ */
+
+    std::string_view peekToken();
+
 /*
  * Method: saveToken
  * Usage: scanner.saveToken(token);
@@ -120,23 +202,44 @@ public:
  * Pushes the specified token back into this scanner's input stream.
  * On the next call to <code>nextToken</code>, the scanner will return
  * the saved token without reading any additional characters from the
- * token stream.
+ * token stream.  If the token is the view most recently returned by
+ * <code>nextTokenView</code> over a string input, the scanner simply
+ * moves back to the start of that token instead of storing a copy.
+ * At most <code>MAX_SAVED_TOKENS</code> tokens can be saved at once.
  */
 
     void saveToken(std::string token);
 
+    void saveToken(std::string_view token);
+
 /*
  * Method: getPosition
  * Usage: int pos = scanner.getPosition();
  * ---------------------------------------
- * Returns the current position of the scanner in the input stream.
- * If <code>saveToken</code> has been called, this position corresponds
- * to the beginning of the saved token.  If <code>saveToken</code> is
- * called more than once, <code>getPosition</code> returns -1.
+ * Returns the current position of the scanner, counted in characters
+ * from the point where it started reading its input.  If tokens have
+ * been saved, this position corresponds to the beginning of the one
+ * that will be read next.  Otherwise it is the position just after the
+ * last character read, which comes before any whitespace that precedes
+ * the next token.
  */
 
     int getPosition() const;
 
+/*
+ * Method: getTokenSpan
+ * Usage: SourceSpan span = scanner.getTokenSpan();
+ * ------------------------------------------------
+ * Returns the span of the token most recently returned by
+ * <code>nextToken</code> or <code>nextTokenView</code>.  After the last
+ * token it is an empty span at the end of the input.  The span is
+ * recorded as the token is scanned, so asking for it costs nothing.
+ * A saved token keeps the span of the token that was read last when
+ * it was saved, which is right when a token is pushed back.
+ */
+
+    SourceSpan getTokenSpan() const;
+
 /*
  * Method: ignoreWhitespace
  * Usage: scanner.ignoreWhitespace();
@@ -269,7 +372,7 @@ public:
  * <code>STRING</code>, or <code>OPERATOR</code>.
  */
 
-    TokenType getTokenType(std::string token) const;
+    TokenType getTokenType(std::string_view token) const;
 
 /*
  * Method: getChar
@@ -311,20 +414,134 @@ public:
 private:
 
 /*
- * Private type: StringCell
+ * Private constant: MAX_SAVED_TOKENS
+ * ----------------------------------
+ * The capacity of the lookahead buffer.  The parser never needs more
+ * than one token of lookahead, so this is generous.
+ */
+
+    static constexpr int MAX_SAVED_TOKENS = 8;
+
+/*
+ * Private type: SavedToken
  * ------------------------
- * This type is used to construct linked lists of cells, which are used
- * to represent both the stack of saved tokens and the set of defined
- * operators.  These types cannot use the Stack and Lexicon classes
- * directly because tokenscanner.h is an extremely low-level interface,
- * and doing so would create circular dependencies in the .h files.
+ * An entry in the ring of saved tokens, which remembers where the token
+ * came from as well as its text.
+ */
+
+    struct SavedToken {
+        std::string text;
+        SourceSpan span;
+        size_t position;
+    };
+
+/*
+ * Private constants: character classes
+ * ------------------------------------
+ * Each entry of a character-class table is a set of these bits, so
+ * that any question the scanner asks about a character is answered by
+ * a single lookup.
+ */
+
+    enum CharClass : unsigned char {
+        SPACE_CLASS = 1,                 /* Matches isspace              */
+        DIGIT_CLASS = 2,                 /* Matches isdigit              */
+        WORD_CLASS = 4,                  /* Allowed in a word            */
+        QUOTE_CLASS = 8                  /* Opens a string               */
+    };
+
+    using ClassTable = std::array<unsigned char, 256>;
+
+    static constexpr ClassTable makeClassTable() {
+        ClassTable table = {};
+        for (int ch = 0; ch < 256; ch++) {
+            unsigned char bits = 0;
+            if (ch == ' ' || (ch >= '\t' && ch <= '\r')) bits |= SPACE_CLASS;
+            if (ch >= '0' && ch <= '9') bits |= DIGIT_CLASS | WORD_CLASS;
+            if ((ch >= 'A' && ch <= 'Z') || (ch >= 'a' && ch <= 'z')) bits |= WORD_CLASS;
+            if (ch == '"' || ch == '\'') bits |= QUOTE_CLASS;
+            table[ch] = bits;
+        }
+        return table;
+    }
+
+/*
+ * Private type: OperatorTrie
+ * --------------------------
+ * The set of operators, stored as a trie so that the longest operator
+ * at the cursor is found in one pass.  The first character of an
+ * operator is looked up directly in root; later characters follow
+ * first-child, next-sibling links, and node 0 stands for "no node".
+ * Every member function is constexpr, so the default operator set is
+ * built at compile time.  The trie has room for MAX_NODES nodes and
+ * add returns false once it is full.
  */
 
-    struct StringCell {
-        std::string str;
-        StringCell *link;
+    struct OperatorTrie {
+
+        static constexpr int MAX_NODES = 128;
+
+        struct Node {
+            char ch = 0;
+            bool accepting = false;
+            unsigned char child = 0;
+            unsigned char sibling = 0;
+        };
+
+        std::array<unsigned char, 256> root = {};
+        std::array<Node, MAX_NODES> nodes = {};
+        int count = 1;
+
+        constexpr int step(int node, int ch) const {
+            if (node == 0) return root[ch];
+            for (int n = nodes[node].child; n != 0; n = nodes[n].sibling) {
+                if ((unsigned char) nodes[n].ch == ch) return n;
+            }
+            return 0;
+        }
+
+        constexpr bool add(std::string_view op) {
+            int node = 0;
+            for (char c : op) {
+                int ch = (unsigned char) c;
+                int next = step(node, ch);
+                if (next == 0) {
+                    if (count == MAX_NODES) return false;
+                    next = count++;
+                    nodes[next].ch = c;
+                    if (node == 0) {
+                        root[ch] = next;
+                    } else {
+                        nodes[next].sibling = nodes[node].child;
+                        nodes[node].child = next;
+                    }
+                }
+                node = next;
+            }
+            if (node != 0) nodes[node].accepting = true;
+            return true;
+        }
+
     };
 
+    static constexpr OperatorTrie makeOperatorTrie(std::initializer_list<std::string_view> ops) {
+        OperatorTrie trie;
+        for (std::string_view op : ops) trie.add(op);
+        return trie;
+    }
+
+/*
+ * Private constants: DEFAULT_CLASSES, BASIC_OPERATORS
+ * ---------------------------------------------------
+ * The tables every scanner starts from, both computed at compile time.
+ * A scanner works on its own copy of the class table, which
+ * addWordCharacters extends, and shares BASIC_OPERATORS until
+ * addOperator needs a private copy.
+ */
+
+    static const ClassTable DEFAULT_CLASSES;
+    static const OperatorTrie BASIC_OPERATORS;
+
     enum NumberScannerState {
         INITIAL_STATE,
         BEFORE_DECIMAL_POINT,
@@ -336,30 +553,58 @@ private:
     };
 
     std::string buffer;              /* The original argument string */
-    std::istream *isp = nullptr;     /* The input stream for tokens  */
+    std::string_view view;           /* The characters being scanned */
+    size_t cursor = 0;               /* Position of the next one     */
+    int line = 1;                    /* Line of the cursor           */
+    size_t lineStart = 0;            /* Position where it starts     */
+    size_t prevLineStart = 0;        /* Start of the line before     */
+    size_t start = 0;                /* Start of the current token   */
+    int startLine = 1;               /* Line at the start            */
+    size_t startLineStart = 0;       /* Position where it starts     */
+    SourceSpan span = {1, 0, 0};     /* Span of the last token read  */
+    size_t spanStart = 0;            /* Its position in the input    */
+    std::string current;             /* The current token text when  */
+                                     /* reading from a stream        */
+    std::istream *isp = nullptr;     /* The input stream, if any     */
+    const SourceToken *tokens = nullptr;   /* Pre-scanned tokens, if any */
+    size_t tokenCount = 0;           /* Number of pre-scanned tokens */
+    size_t tokenIndex = 0;           /* Index of the next one        */
     bool ignoreWhitespaceFlag;       /* Scanner ignores whitespace   */
     bool ignoreCommentsFlag;         /* Scanner ignores comments     */
     bool scanNumbersFlag;            /* Scanner parses numbers       */
     bool scanStringsFlag;            /* Scanner parses strings       */
-    std::string wordChars;           /* Additional word characters   */
-    StringCell *savedTokens = nullptr;         /* Stack of saved tokens        */
-    StringCell *operators = nullptr;           /* List of multichar operators  */
+    ClassTable classes;              /* Class of every character     */
+    std::array<SavedToken, MAX_SAVED_TOKENS> saved;   /* Ring of saved tokens */
+    int savedHead = 0;               /* Index of the next saved one  */
+    int savedCount = 0;              /* Number of saved tokens       */
+    const OperatorTrie *operators;   /* The operators recognized     */
+    std::unique_ptr<OperatorTrie> ownOperators;   /* Copy made by addOperator */
 
 /* Private method prototypes */
 
     void initScanner();
 
+    int get();
+
+    void unget();
+
+    std::string_view token() const;
+
+    std::string_view finishToken();
+
+    void rewind(size_t position, int line, size_t lineStart);
+
     void skipSpaces();
 
-    std::string scanWord();
+    void scanWord();
 
-    std::string scanNumber();
+    void scanNumber();
 
-    std::string scanString();
+    void scanString();
 
-    bool isOperator(std::string op);
+    bool isClass(int ch, unsigned char bits) const;
 
-    bool isOperatorPrefix(std::string op);
+    void scanOperator(int ch);
 
 };
 
@@ -0,0 +1,86 @@
+/*
+ * File: arena.cpp
+ * ---------------
+ * This file implements the Arena class.
+ */
+
+#include <new>
+#include "arena.hpp"
+
+
+/*
+ * Implementation notes: blocks
+ * ----------------------------
+ * Each block starts with a header that links it to the previously
+ * allocated block, padded to the alignment of max_align_t so that the
+ * storage after it is suitably aligned.  Every block is twice the size
+ * of the one before, so a large expression needs few of them.
+ */
+
+static const size_t ALIGNMENT = alignof(std::max_align_t);
+
+static size_t roundUp(size_t size) {
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+Arena::Arena() = default;
+
+Arena::Arena(Arena &&other) noexcept : blocks(other.blocks), next(other.next), limit(other.limit) {
+    other.blocks = nullptr;
+    other.next = other.limit = nullptr;
+}
+
+Arena &Arena::operator=(Arena &&other) noexcept {
+    if (this != &other) {
+        clear();
+        blocks = other.blocks;
+        next = other.next;
+        limit = other.limit;
+        other.blocks = nullptr;
+        other.next = other.limit = nullptr;
+    }
+    return *this;
+}
+
+Arena::~Arena() {
+    clear();
+}
+
+void *Arena::allocate(size_t size) {
+    size = roundUp(size);
+    if (size > size_t(limit - next)) grow(size);
+    void *ptr = next;
+    next += size;
+    return ptr;
+}
+
+void Arena::clear() {
+    while (blocks != nullptr) {
+        Block *block = blocks;
+        blocks = block->next;
+        ::operator delete(block);
+    }
+    next = limit = nullptr;
+}
+
+void Arena::reset() {
+    if (blocks == nullptr) return;
+    while (blocks->next != nullptr) {
+        Block *block = blocks->next;
+        blocks->next = block->next;
+        ::operator delete(block);
+    }
+    next = (char *) blocks + roundUp(sizeof(Block));
+}
+
+void Arena::grow(size_t size) {
+    size_t header = roundUp(sizeof(Block));
+    size_t capacity = BLOCK_SIZE;
+    if (blocks != nullptr) capacity = 2 * size_t(limit - (char *) blocks);
+    if (capacity < header + size) capacity = header + size;
+    auto *block = (Block *) ::operator new(capacity);
+    block->next = blocks;
+    blocks = block;
+    next = (char *) block + header;
+    limit = (char *) block + capacity;
+}
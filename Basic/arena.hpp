@@ -0,0 +1,104 @@
+/*
+ * File: arena.h
+ * -------------
+ * This interface exports the Arena class, a bump allocator that holds
+ * the expression and statement nodes of parsed lines.
+ */
+
+#ifndef _arena_h
+#define _arena_h
+
+#include <cstddef>
+
+/*
+ * Class: Arena
+ * ------------
+ * Memory is handed out from large blocks by advancing a pointer, and is
+ * only ever given back all at once, when the arena is cleared or
+ * destroyed.  No destructors are run for the objects allocated in it,
+ * so only objects whose destructors do nothing may be placed here.
+ *
+ * Arenas can be moved but not copied.  Moving transfers the blocks, so
+ * objects allocated before the move stay where they are.
+ */
+
+class Arena {
+
+public:
+
+/*
+ * Constructor: Arena
+ * Usage: Arena arena;
+ * -------------------
+ * Creates an empty arena.  No memory is reserved until the first call
+ * to allocate.
+ */
+
+    Arena();
+
+    Arena(Arena &&other) noexcept;
+
+    Arena &operator=(Arena &&other) noexcept;
+
+    Arena(const Arena &) = delete;
+
+    Arena &operator=(const Arena &) = delete;
+
+/*
+ * Destructor: ~Arena
+ * Usage: usually implicit
+ * -----------------------
+ * Frees every block owned by the arena.
+ */
+
+    ~Arena();
+
+/*
+ * Method: allocate
+ * Usage: void *ptr = arena.allocate(size);
+ * ----------------------------------------
+ * Returns size bytes of storage, aligned for any fundamental type.
+ */
+
+    void *allocate(size_t size);
+
+/*
+ * Method: clear
+ * Usage: arena.clear();
+ * ---------------------
+ * Releases everything allocated from the arena.  The cost depends only
+ * on the number of blocks, which grows with the logarithm of the total
+ * size allocated, not with the number of objects.
+ */
+
+    void clear();
+
+/*
+ * Method: reset
+ * Usage: arena.reset();
+ * ---------------------
+ * Releases everything allocated from the arena like clear, but keeps
+ * the most recent block for reuse.  An arena that is reset before each
+ * use, such as the scratch arena of immediate mode, therefore stops
+ * calling the system allocator once it has grown large enough.
+ */
+
+    void reset();
+
+private:
+
+    struct Block {
+        Block *next;
+    };
+
+    static const size_t BLOCK_SIZE = 512;    /* Size of the first block  */
+
+    Block *blocks = nullptr;                 /* Most recent block first  */
+    char *next = nullptr;                    /* Free space in that block */
+    char *limit = nullptr;                   /* End of that block        */
+
+    void grow(size_t size);
+
+};
+
+#endif
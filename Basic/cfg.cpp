@@ -0,0 +1,175 @@
+/*
+ * File: cfg.cpp
+ * -------------
+ * This file implements the ControlFlowGraph class.
+ */
+
+#include <algorithm>
+#include "cfg.hpp"
+#include "program.hpp"
+
+
+/*
+ * Implementation notes: constructor
+ * ---------------------------------
+ * The graph is built in three passes over the lines in order.  The
+ * first marks the leaders, the lines that start a block: the first
+ * line, every line that some GOTO, IF or GOSUB names, and every line
+ * after a GOTO, IF, END, GOSUB or RETURN.  The second cuts the program
+ * into blocks at the leaders and links each block to the ones that
+ * follow it.  The third marks the blocks that can be reached from the
+ * first one, using an explicit stack so that long chains of blocks
+ * cannot overflow the C++ stack.  The blocks that are left are then
+ * renumbered in order.
+ *
+ * A GOSUB block leads both to the subroutine and to the block after
+ * it, which is where the subroutine returns to, so every return point
+ * is the start of a live block.  A RETURN block leads nowhere by
+ * itself, since the blocks it can return to are already reached
+ * through the GOSUB blocks that call it.
+ *
+ * Program has already resolved the target of every jump to a slot, so
+ * no pass has to search for a line.
+ */
+
+static bool endsBlock(Statement *stmt) {
+    switch (stmt->getType()) {
+        case GOTO_STMT:
+        case IF_STMT:
+        case END_STMT:
+        case GOSUB_STMT:
+        case RETURN_STMT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+ControlFlowGraph::ControlFlowGraph(Program &program) {
+    std::vector<int> order;
+    std::vector<int> position(program.slots.size(), -1);
+    for (int slot = program.first; slot != -1; slot = program.slots[slot].next) {
+        position[slot] = int(order.size());
+        order.push_back(slot);
+    }
+    int n = int(order.size());
+    std::vector<char> leader(n);
+    if (n > 0) leader[0] = true;
+    for (int i = 0; i < n; i++) {
+        Program::Line &line = program.slots[order[i]];
+        if (line.target != -1) leader[position[line.target]] = true;
+        if (endsBlock(line.stmt) && i + 1 < n) leader[i + 1] = true;
+    }
+
+    std::vector<BasicBlock> all;
+    std::vector<int> blockOf(n);
+    for (int i = 0; i < n; i++) {
+        if (leader[i]) {
+            all.emplace_back();
+            all.back().hits = all.back().startHits = program.slots[order[i]].hits;
+        }
+        blockOf[i] = int(all.size()) - 1;
+        all.back().lines.push_back(program.slots[order[i]].number);
+        all.back().statements.push_back(program.slots[order[i]].stmt);
+    }
+    for (int i = 0; i < n; i++) {
+        if (i + 1 < n && !leader[i + 1]) continue;
+        BasicBlock &block = all[blockOf[i]];
+        Program::Line &line = program.slots[order[i]];
+        if (i + 1 < n) {
+            block.next = blockOf[i + 1];
+            block.nextLine = program.slots[order[i + 1]].number;
+        }
+        block.targetLine = line.targetNumber;
+        if (line.target != -1) block.target = blockOf[position[line.target]];
+    }
+
+    std::vector<char> live(all.size());
+    std::vector<int> pending;
+    if (!all.empty()) {
+        live[0] = true;
+        pending.push_back(0);
+    }
+    while (!pending.empty()) {
+        BasicBlock &block = all[pending.back()];
+        pending.pop_back();
+        StatementType type = block.statements.back()->getType();
+        int successors[] = {
+            type == GOTO_STMT || type == END_STMT || type == RETURN_STMT ? -1 : block.next,
+            block.target
+        };
+        for (int successor : successors) {
+            if (successor != -1 && !live[successor]) {
+                live[successor] = true;
+                pending.push_back(successor);
+            }
+        }
+    }
+
+    std::vector<int> renumbered(all.size(), -1);
+    for (size_t b = 0; b < all.size(); b++) {
+        if (live[b]) {
+            renumbered[b] = int(blocks.size());
+            blocks.push_back(std::move(all[b]));
+        } else {
+            deadLines.insert(deadLines.end(), all[b].lines.begin(), all[b].lines.end());
+        }
+    }
+    for (BasicBlock &block : blocks) {
+        if (block.next != -1) block.next = renumbered[block.next];
+        if (block.target != -1) block.target = renumbered[block.target];
+    }
+}
+
+std::vector<BasicBlock> &ControlFlowGraph::getBlocks() {
+    return blocks;
+}
+
+std::vector<int> &ControlFlowGraph::getDeadLines() {
+    return deadLines;
+}
+
+int ControlFlowGraph::findBlock(int lineNumber) {
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), lineNumber,
+                               [](int number, const BasicBlock &block) {
+                                   return number < block.lines.front();
+                               });
+    if (it == blocks.begin()) return -1;
+    --it;
+    if (!std::binary_search(it->lines.begin(), it->lines.end(), lineNumber)) return -1;
+    return int(it - blocks.begin());
+}
+
+/*
+ * Implementation notes: print
+ * ---------------------------
+ * The successors are worked out from the final statement of each block
+ * in the same way as the constructor does when it marks live blocks.
+ */
+
+void ControlFlowGraph::print(std::ostream &out) {
+    for (size_t b = 0; b < blocks.size(); b++) {
+        BasicBlock &block = blocks[b];
+        out << 'B' << b << " [" << block.lines.front();
+        if (block.lines.size() > 1) out << '-' << block.lines.back();
+        out << "] ->";
+        StatementType type = block.statements.back()->getType();
+        if (type == GOTO_STMT || type == IF_STMT || type == GOSUB_STMT) {
+            if (block.target != -1) out << " B" << block.target;
+            else out << " LINE " << block.targetLine;
+        }
+        if (type == RETURN_STMT) {
+            out << " RETURN";
+        } else if (type != GOTO_STMT && type != END_STMT) {
+            if (block.next != -1) out << " B" << block.next;
+            else out << " END";
+        }
+        if (type == END_STMT) out << " END";
+        out << '\n';
+    }
+    if (!deadLines.empty()) {
+        out << "DEAD";
+        for (int line : deadLines) out << ' ' << line;
+        out << '\n';
+    }
+}
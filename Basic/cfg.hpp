@@ -0,0 +1,128 @@
+/*
+ * File: cfg.h
+ * -----------
+ * This interface exports the ControlFlowGraph class, which divides a
+ * program into basic blocks: runs of lines that are always executed
+ * from the first to the last.  Lines that no run of the program can
+ * reach are left out of the graph altogether, so every back end that
+ * works from it skips them.
+ */
+
+#ifndef _cfg_h
+#define _cfg_h
+
+#include <iostream>
+#include <vector>
+#include "statement.hpp"
+
+class Program;
+
+/*
+ * Type: BasicBlock
+ * ----------------
+ * One block of the graph.  A block ends at a GOTO, IF, END, GOSUB or
+ * RETURN, or just before a line that some jump names, so only its last
+ * statement can change the line that runs next.  next and target are
+ * indices of blocks, or -1: next is the block that starts with the
+ * line after the block, even if the block ends with a GOTO or END, and
+ * target is the block that the final GOTO, IF or GOSUB jumps to.
+ * nextLine and targetLine are the numbers of those lines, or -1 if
+ * there is no such line in the program text; a jump to a line that
+ * does not exist has a targetLine but no target.  hits starts at the
+ * count that Program keeps for the first line of the block, so counts
+ * carry over when the graph is rebuilt.
+ */
+
+struct BasicBlock {
+    std::vector<int> lines;                /* Line numbers, in order   */
+    std::vector<Statement *> statements;   /* Statement of each line   */
+    int next = -1;
+    int target = -1;
+    int nextLine = -1;
+    int targetLine = -1;
+    long long hits = 0;                    /* Runs in the interpreter  */
+    long long startHits = 0;               /* hits when the graph was built */
+};
+
+/*
+ * Class: ControlFlowGraph
+ * -----------------------
+ * The basic blocks of a program that can be reached from its first
+ * line, in line-number order, so the first block is the entry.  The
+ * graph holds pointers to the statements of the program and must be
+ * rebuilt whenever the program changes; Program does this for the
+ * graph it returns from getControlFlowGraph.
+ */
+
+class ControlFlowGraph {
+
+public:
+
+/*
+ * Constructor: ControlFlowGraph
+ * Usage: ControlFlowGraph graph(program);
+ * ---------------------------------------
+ * Builds the graph of program.  The cost is linear in the number of
+ * lines, since every jump target has already been resolved by Program.
+ */
+
+    ControlFlowGraph(Program &program);
+
+/*
+ * Method: getBlocks
+ * Usage: for (BasicBlock &block : graph.getBlocks()) . . .
+ * --------------------------------------------------------
+ * Returns the reachable blocks in line-number order.
+ */
+
+    std::vector<BasicBlock> &getBlocks();
+
+/*
+ * Method: getDeadLines
+ * Usage: std::vector<int> &lines = graph.getDeadLines();
+ * ------------------------------------------------------
+ * Returns the numbers of the lines that cannot be reached, in order.
+ */
+
+    std::vector<int> &getDeadLines();
+
+/*
+ * Method: findBlock
+ * Usage: int block = graph.findBlock(lineNumber);
+ * -----------------------------------------------
+ * Returns the index of the block that contains the line, or -1 if the
+ * line does not exist or cannot be reached.
+ */
+
+    int findBlock(int lineNumber);
+
+/*
+ * Method: print
+ * Usage: graph.print(std::cout);
+ * ------------------------------
+ * Writes one line per block, as used by the CFG command:
+ *
+ *   B0 [10-30] -> B2 B1
+ *   B1 [40] -> B0
+ *   B2 [50-60] -> END
+ *   B3 [70] -> LINE 999
+ *   DEAD 80 90
+ *
+ * The lines of a block are given as the first and last.  A block that
+ * ends with IF or GOSUB lists the block it jumps to before the one it
+ * falls through or returns to, and one that ends with RETURN is shown
+ * as leading to RETURN.  END stands for the end of the program, and
+ * LINE n for a jump to a line n that does not exist.  The final line
+ * lists the lines that cannot be reached, if there are any.
+ */
+
+    void print(std::ostream &out);
+
+private:
+
+    std::vector<BasicBlock> blocks;
+    std::vector<int> deadLines;
+
+};
+
+#endif
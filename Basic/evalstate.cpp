@@ -7,6 +7,7 @@
  */
 
 
+#include <unordered_map>
 #include "evalstate.hpp"
 
 
@@ -22,20 +23,84 @@ EvalState::~EvalState() {
     /* Empty */
 }
 
-void EvalState::setValue(std::string var, int value) {
-    if(isDefined(var)) symbolTable[var] = value;
-    else symbolTable.emplace(var,value);
+/*
+ * Implementation notes: intern
+ * ----------------------------
+ * The name table lives in function-local statics so that it is
+ * initialized before the first identifier is parsed, whatever the
+ * order of static initialization across translation units.
+ *
+ * The table only grows between two CLEAR commands: it keeps the names
+ * of lines that have since been replaced or removed.  That is a
+ * deliberate limit, since any statement or value in an EvalState may
+ * still refer to an ID, and renumbering them all would cost more than
+ * the names do.  CLEAR empties the program and the variables, so it
+ * is the one point where the table can be dropped as a whole.
+ */
+
+static std::vector<std::string> &names() {
+    static std::vector<std::string> table;
+    return table;
 }
 
-int EvalState::getValue(std::string var) {
-    if(isDefined(var)) return symbolTable[var];
-    else return 0;
+static std::unordered_map<std::string, int> &ids() {
+    static std::unordered_map<std::string, int> table;
+    return table;
 }
 
-bool EvalState::isDefined(std::string var) {
-    return symbolTable.find(var)!=symbolTable.end();
+/*
+ * Implementation notes: find
+ * --------------------------
+ * Looks name up without interning it, returning -1 if it has never been
+ * seen.  The string overloads of getValue and isDefined use it so that
+ * asking about a name, even a mistyped one, does not grow the table.
+ */
+
+static int find(const std::string &name) {
+    auto it = ids().find(name);
+    return it == ids().end() ? -1 : it->second;
+}
+
+int EvalState::intern(const std::string &name) {
+    auto it = ids().find(name);
+    if (it != ids().end()) return it->second;
+    names().push_back(name);
+    return ids()[name] = int(names().size()) - 1;
+}
+
+void EvalState::clearNames() {
+    std::vector<std::string>().swap(names());
+    std::unordered_map<std::string, int>().swap(ids());
+}
+
+const std::string &EvalState::getName(int id) {
+    return names()[id];
+}
+
+void EvalState::setValue(int id, int value) {
+    if (size_t(id) >= values.size()) {
+        values.resize(id + 1);
+        defined.resize(id + 1);
+    }
+    values[id] = value;
+    defined[id] = true;
+}
+
+void EvalState::setValue(const std::string &var, int value) {
+    setValue(intern(var), value);
+}
+
+int EvalState::getValue(const std::string &var) const {
+    int id = find(var);
+    return id == -1 ? 0 : getValue(id);
+}
+
+bool EvalState::isDefined(const std::string &var) const {
+    int id = find(var);
+    return id != -1 && isDefined(id);
 }
 
 void EvalState::Clear() {
-    symbolTable.clear();
-}
\ No newline at end of file
+    values.clear();
+    defined.clear();
+}
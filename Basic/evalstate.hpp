@@ -10,7 +10,7 @@
 #define _evalstate_h
 
 #include <string>
-#include <map>
+#include <vector>
 
 /*
  * Class: EvalState
@@ -49,38 +49,93 @@ public:
 
     ~EvalState();
 
+/*
+ * Method: intern
+ * Usage: int id = EvalState::intern(name);
+ * ----------------------------------------
+ * Returns the integer ID of the variable called name, allocating the
+ * next free ID the first time a name is seen.  IDs are shared by every
+ * EvalState and never reused until clearNames, so the parser can
+ * resolve each identifier once and the evaluator can index by ID from
+ * then on.
+ */
+
+    static int intern(const std::string &name);
+
+/*
+ * Method: clearNames
+ * Usage: EvalState::clearNames();
+ * -------------------------------
+ * Forgets every interned name, so that IDs start again from zero.  It
+ * may only be called when no statement or EvalState holds an ID, as is
+ * the case after CLEAR.
+ */
+
+    static void clearNames();
+
+/*
+ * Method: getName
+ * Usage: std::string name = EvalState::getName(id);
+ * -------------------------------------------------
+ * Returns the name of the variable with the given ID.
+ */
+
+    static const std::string &getName(int id);
+
 /*
  * Method: setValue
- * Usage: state.setValue(var, value);
+ * Usage: state.setValue(id, value);
+ *        state.setValue(var, value);
  * ----------------------------------
- * Sets the value associated with the specified var.
+ * Sets the value associated with the specified variable.
  */
 
-    void setValue(std::string var, int value);
+    void setValue(int id, int value);
+    void setValue(const std::string &var, int value);
 
 /*
  * Method: getValue
- * Usage: int value = state.getValue(var);
+ * Usage: int value = state.getValue(id);
+ *        int value = state.getValue(var);
  * ---------------------------------------
- * Returns the value associated with the specified variable.
+ * Returns the value associated with the specified variable, or 0 if it
+ * is not defined.  Looking a variable up by name never interns it.
  */
 
-    int getValue(std::string var);
+    int getValue(int id) const {
+        return isDefined(id) ? values[id] : 0;
+    }
+
+    int getValue(const std::string &var) const;
 
 /*
  * Method: isDefined
- * Usage: if (state.isDefined(var)) . . .
+ * Usage: if (state.isDefined(id)) . . .
+ *        if (state.isDefined(var)) . . .
  * --------------------------------------
  * Returns true if the specified variable is defined.
  */
 
-    bool isDefined(std::string var);
+    bool isDefined(int id) const {
+        return size_t(id) < defined.size() && defined[id];
+    }
+
+    bool isDefined(const std::string &var) const;
 
     void Clear();
 
 private:
 
-    std::map<std::string, int> symbolTable;
+/*
+ * Implementation notes: storage
+ * -----------------------------
+ * Values are held in a vector indexed by variable ID, with a bitmap
+ * recording which of them are defined.  Both grow on demand, so a
+ * state only pays for the IDs it has actually been given.
+ */
+
+    std::vector<int> values;
+    std::vector<bool> defined;
 
 };
 
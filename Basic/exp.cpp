@@ -10,13 +10,28 @@
 /*
  * Implementation notes: the Expression class
  * ------------------------------------------
- * The Expression class declares no instance variables and needs no code.
+ * The Expression class declares no instance variables.  Its allocation
+ * functions route every node into an arena; the placement delete is
+ * what the compiler calls if a constructor throws, and leaves the
+ * storage to be reclaimed with the rest of the arena.
  */
 
 Expression::Expression() = default;
 
 Expression::~Expression() = default;
 
+void *Expression::operator new(size_t size, Arena &arena) {
+    return arena.allocate(size);
+}
+
+void Expression::operator delete(void *, Arena &) {
+    /* Empty */
+}
+
+void Expression::operator delete(void *) {
+    /* Empty */
+}
+
 /*
  * Implementation notes: the ConstantExp subclass
  * ----------------------------------------------
@@ -41,6 +56,10 @@ ExpressionType ConstantExp::getType() {
     return CONSTANT;
 }
 
+bool ConstantExp::hasEffects() {
+    return false;
+}
+
 int ConstantExp::getValue() {
     return value;
 }
@@ -48,91 +67,116 @@ int ConstantExp::getValue() {
 /*
  * Implementation notes: the IdentifierExp subclass
  * ------------------------------------------------
- * The IdentifierExp subclass declares a single instance variable that
- * stores the name of the variable.  The implementation of eval must
- * look this variable up in the evaluation state.
+ * The IdentifierExp subclass stores only the interned ID of the
+ * variable, so that the node needs no destructor; the name is looked
+ * up again when it is asked for.  The implementation of eval looks the
+ * ID up in the evaluation state, which is a plain index.
  */
 
 IdentifierExp::IdentifierExp(std::string name) {
-    this->name = name;
+    this->id = EvalState::intern(name);
 }
 
 int IdentifierExp::eval(EvalState &state) {
-    if (!state.isDefined(name)) error("VARIABLE NOT DEFINED");
-    return state.getValue(name);
+    if (!state.isDefined(id)) error("VARIABLE NOT DEFINED");
+    return state.getValue(id);
 }
 
 std::string IdentifierExp::toString() {
-    return name;
+    return EvalState::getName(id);
 }
 
 ExpressionType IdentifierExp::getType() {
     return IDENTIFIER;
 }
 
+bool IdentifierExp::hasEffects() {
+    return false;
+}
+
 std::string IdentifierExp::getName() {
-    return name;
+    return EvalState::getName(id);
+}
+
+int IdentifierExp::getId() {
+    return id;
 }
 
 /*
- * Implementation notes: the CompoundExp subclass
- * ----------------------------------------------
- * The CompoundExp subclass declares instance variables for the operator
- * and the left and right subexpressions.  The implementation of eval 
- * evaluates the subexpressions recursively and then applies the operator.
+ * Implementation notes: the NegateExp subclass
+ * --------------------------------------------
+ * The value is computed as 0 - operand, exactly as the SubExp that the
+ * parser used to build for a unary minus, so the result is the same for
+ * every operand.  A negation has effects exactly when its operand does.
  */
 
-CompoundExp::CompoundExp(std::string op, Expression *lhs, Expression *rhs) {
-    this->op = op;
-    this->lhs = lhs;
-    this->rhs = rhs;
+NegateExp::NegateExp(Expression *operand) {
+    this->operand = operand;
+    this->effects = operand->hasEffects();
+}
+
+int NegateExp::eval(EvalState &state) {
+    return 0 - operand->eval(state);
+}
+
+std::string NegateExp::toString() {
+    return "(-" + operand->toString() + ')';
+}
+
+ExpressionType NegateExp::getType() {
+    return NEGATE;
 }
 
-CompoundExp::~CompoundExp() {
-    delete lhs;
-    delete rhs;
+bool NegateExp::hasEffects() {
+    return effects;
+}
+
+Expression *NegateExp::getOperand() {
+    return operand;
+}
+
+std::string operatorToString(Operator op) {
+    switch (op) {
+        case ASSIGN_OP: return "=";
+        case ADD_OP: return "+";
+        case SUB_OP: return "-";
+        case MUL_OP: return "*";
+        case DIV_OP: return "/";
+    }
+    return "";
 }
 
 /*
- * Implementation notes: eval
- * --------------------------
- * The eval method for the compound expression case must check for the
- * assignment operator as a special case.  Unlike the arithmetic operators
- * the assignment operator does not evaluate its left operand.
+ * Implementation notes: the CompoundExp subclass
+ * ----------------------------------------------
+ * The CompoundExp subclass declares instance variables for the operator
+ * and the left and right subexpressions.  The operator is an enum and
+ * is kept only for clients that inspect the tree; evaluation dispatches
+ * through the virtual eval of the subclass for that operator.  The
+ * effects flag is combined from the flags of the subexpressions, which
+ * are always built first, so hasEffects never walks the tree.
  */
 
-int CompoundExp::eval(EvalState &state) {
-    if (op == "=") {
-        if (lhs->getType() != IDENTIFIER) {
-            error("Illegal variable in assignment");
-        }
-        if (lhs->getType() == IDENTIFIER && lhs->toString() == "LET")
-            error("SYNTAX ERROR");
-        int val = rhs->eval(state);
-        state.setValue(((IdentifierExp *) lhs)->getName(), val);
-        return val;
-    }
-    int left = lhs->eval(state);
-    int right = rhs->eval(state);
-    if (op == "+") return left + right;
-    if (op == "-") return left - right;
-    if (op == "*") return left * right;
-    if (op == "/") {
-        if (right == 0) error("DIVIDE BY ZERO");
-        return left / right;
-    }
-    return 0;
+CompoundExp::CompoundExp(Operator op, Expression *lhs, Expression *rhs) {
+    this->op = op;
+    this->lhs = lhs;
+    this->rhs = rhs;
+    this->effects = op == ASSIGN_OP || op == DIV_OP || lhs->hasEffects() || rhs->hasEffects();
 }
 
 std::string CompoundExp::toString() {
-    return '(' + lhs->toString() + ' ' + op + ' ' + rhs->toString() + ')';
+    return '(' + lhs->toString() + ' ' + operatorToString(op) + ' ' + rhs->toString() + ')';
 }
 
 ExpressionType CompoundExp::getType() {
     return COMPOUND;
 }
 
-std::string CompoundExp::getOp() {
+bool CompoundExp::hasEffects() {
+    return effects;
+}
+
+Operator CompoundExp::getOp() {
     return op;
 }
 
@@ -143,3 +187,86 @@ Expression *CompoundExp::getLHS() {
 Expression *CompoundExp::getRHS() {
     return rhs;
 }
+
+/*
+ * Implementation notes: AssignExp::eval
+ * -------------------------------------
+ * Unlike the arithmetic operators, the assignment operator does not
+ * evaluate its left operand, which must be a variable other than LET.
+ * The constructor checks the target once, recording either its ID or
+ * the message to report, and eval only raises the error when it runs,
+ * so errors are still reported in evaluation order.
+ */
+
+AssignExp::AssignExp(Expression *lhs, Expression *rhs) : CompoundExp(ASSIGN_OP, lhs, rhs) {
+    if (lhs->getType() != IDENTIFIER) {
+        message = "Illegal variable in assignment";
+    } else if (((IdentifierExp *) lhs)->getName() == "LET") {
+        message = "SYNTAX ERROR";
+    } else {
+        varId = ((IdentifierExp *) lhs)->getId();
+    }
+}
+
+int AssignExp::eval(EvalState &state) {
+    if (message != nullptr) error(message);
+    int val = rhs->eval(state);
+    state.setValue(varId, val);
+    return val;
+}
+
+/*
+ * Implementation notes: arithmetic
+ * --------------------------------
+ * Each operator evaluates its left operand before its right one, so
+ * errors are reported in the same order whatever the operator.
+ */
+
+AddExp::AddExp(Expression *lhs, Expression *rhs) : CompoundExp(ADD_OP, lhs, rhs) {
+    /* Empty */
+}
+
+int AddExp::eval(EvalState &state) {
+    int left = lhs->eval(state);
+    return left + rhs->eval(state);
+}
+
+SubExp::SubExp(Expression *lhs, Expression *rhs) : CompoundExp(SUB_OP, lhs, rhs) {
+    /* Empty */
+}
+
+int SubExp::eval(EvalState &state) {
+    int left = lhs->eval(state);
+    return left - rhs->eval(state);
+}
+
+MulExp::MulExp(Expression *lhs, Expression *rhs) : CompoundExp(MUL_OP, lhs, rhs) {
+    /* Empty */
+}
+
+int MulExp::eval(EvalState &state) {
+    int left = lhs->eval(state);
+    return left * rhs->eval(state);
+}
+
+DivExp::DivExp(Expression *lhs, Expression *rhs) : CompoundExp(DIV_OP, lhs, rhs) {
+    /* Empty */
+}
+
+int DivExp::eval(EvalState &state) {
+    int left = lhs->eval(state);
+    int right = rhs->eval(state);
+    if (right == 0) error("DIVIDE BY ZERO");
+    return left / right;
+}
+
+CompoundExp *newCompoundExp(Operator op, Expression *lhs, Expression *rhs, Arena &arena) {
+    switch (op) {
+        case ASSIGN_OP: return new (arena) AssignExp(lhs, rhs);
+        case ADD_OP: return new (arena) AddExp(lhs, rhs);
+        case SUB_OP: return new (arena) SubExp(lhs, rhs);
+        case MUL_OP: return new (arena) MulExp(lhs, rhs);
+        case DIV_OP: return new (arena) DivExp(lhs, rhs);
+    }
+    return nullptr;
+}
@@ -13,27 +13,49 @@
 #include <string>
 #include "Utils/error.hpp"
 #include "evalstate.hpp"
+#include "arena.hpp"
 #include "Utils/strlib.hpp"
 
 /*
  * Type: ExpressionType
  * --------------------
- * This enumerated type is used to differentiate the three different
- * expression types: CONSTANT, IDENTIFIER, and COMPOUND.
+ * This enumerated type is used to differentiate the different
+ * expression types: CONSTANT, IDENTIFIER, NEGATE, and COMPOUND.
  * 此枚举类型用于区分三种不同的表达式类型：CONSTANT、IDENTIFIER和COMPOUND。
  */
 
 enum ExpressionType {
-    CONSTANT, IDENTIFIER, COMPOUND
+    CONSTANT, IDENTIFIER, NEGATE, COMPOUND
 };
 
+/*
+ * Type: Operator
+ * --------------
+ * This enumerated type identifies the operator of a compound
+ * expression.  The parser translates each operator token into one of
+ * these values once, so nothing downstream compares operator strings.
+ */
+
+enum Operator {
+    ASSIGN_OP, ADD_OP, SUB_OP, MUL_OP, DIV_OP
+};
+
+/*
+ * Function: operatorToString
+ * Usage: std::string token = operatorToString(op);
+ * ------------------------------------------------
+ * Returns the token that denotes op in the source, such as "+".
+ */
+
+std::string operatorToString(Operator op);
+
 /*
  * Class: Expression
  * -----------------
  * This class is used to represent a node in an expression tree.
  * Expression is an example of an abstract class, which defines
  * the structure and behavior of a set of classes but has no
- * objects of its own.  Any object must be one of the three
+ * objects of its own.  Any object must be one of the four
  * concrete subclasses of Expression:
  * 此类用于表示表达式树中的节点。表达式是一个抽象类的例子，它定义了一组类的
  * 结构和行为，但没有自己的对象。任何对象都必须是Expression的三个具体子类之一：
@@ -41,6 +63,7 @@ enum ExpressionType {
  *  1. ConstantExp   -- an integer constant
  *  2. IdentifierExp -- a string representing an identifier
  *  3. CompoundExp   -- two expressions combined by an operator
+ *  4. NegateExp     -- the negation of an expression
  *  1.ConstantExp——一个整数常量
  *  2.IdentifierExp——表示标识符的字符串
  *  3.CompoundExp——由一个运算符组合的两个表达式
@@ -75,16 +98,27 @@ public:
 
 /*
  * Destructor: ~Expression
- * Usage: delete exp;
- * ------------------
- * The destructor deallocates the storage for this expression.
- * It must be declared virtual to ensure that the correct subclass
- * destructor is called when deleting an expression.
- * 析构函数取消分配此表达式的存储。它必须声明为虚拟的，以确保在删除表达式时调用正确的子类析构函数。
+ * -----------------------
+ * Expressions never own anything outside their arena, so the
+ * destructor does nothing and is never actually called.
  */
 
     virtual ~Expression();
 
+/*
+ * Operators: new, delete
+ * Usage: Expression *exp = new (arena) ConstantExp(value);
+ * --------------------------------------------------------
+ * Every expression node is allocated from an Arena, which releases a
+ * whole tree at once.  Deleting a single node does nothing.
+ */
+
+    static void *operator new(size_t size, Arena &arena);
+
+    static void operator delete(void *ptr, Arena &arena);
+
+    static void operator delete(void *ptr);
+
 /*
  * Method: eval
  * Usage: int value = exp->eval(state);
@@ -117,6 +151,18 @@ public:
 
     virtual ExpressionType getType() = 0;
 
+/*
+ * Method: hasEffects
+ * Usage: if (exp->hasEffects()) . . .
+ * -----------------------------------
+ * Returns true if evaluating this expression can assign to a variable
+ * or raise an error other than VARIABLE NOT DEFINED.  Compound nodes
+ * work this out when they are built, so the call takes constant time
+ * however deep the tree is.
+ */
+
+    virtual bool hasEffects() = 0;
+
 };
 
 /*
@@ -132,8 +178,8 @@ public:
 
 /*
  * Constructor: ConstantExp
- * Usage: Expression *exp = new ConstantExp(value);
- * ------------------------------------------------
+ * Usage: Expression *exp = new (arena) ConstantExp(value);
+ * --------------------------------------------------------
  * The constructor initializes a new integer constant expression
  * to the given value.
  * 构造函数将一个新的整数常量表达式初始化为给定的值。
@@ -155,6 +201,8 @@ public:
 
     virtual ExpressionType getType();
 
+    virtual bool hasEffects();
+
 /*
  * Method: getValue
  * Usage: int value = ((ConstantExp *) exp)->getValue();
@@ -185,8 +233,8 @@ public:
 
 /*
  * Constructor: IdentifierExp
- * Usage: Expression *exp = new IdentifierExp(name);
- * -------------------------------------------------
+ * Usage: Expression *exp = new (arena) IdentifierExp(name);
+ * ---------------------------------------------------------
  * The constructor initializes a new identifier expression
  * for the variable named by name.
  * 构造函数为按名称命名的变量初始化一个新的标识符表达式。
@@ -208,6 +256,8 @@ public:
 
     virtual ExpressionType getType();
 
+    virtual bool hasEffects();
+
 /*
  * Method: getName
  * Usage: string name = ((IdentifierExp *) exp)->getName();
@@ -219,33 +269,43 @@ public:
 
     std::string getName();
 
+/*
+ * Method: getId
+ * Usage: int id = ((IdentifierExp *) exp)->getId();
+ * -------------------------------------------------
+ * Returns the variable ID that the name was interned to when the node
+ * was created.  See EvalState::intern.
+ */
+
+    int getId();
+
 private:
 
-    std::string name;
+    int id;
 
 };
 
 /*
- * Class: CompoundExp
- * ------------------
- * This subclass represents a compound expression consisting of
- * two subexpressions joined by an operator.
+ * Class: NegateExp
+ * ----------------
+ * This subclass represents the unary minus applied to an expression.
+ * The parser only creates one when the operand is not a literal, since
+ * a negative literal becomes a ConstantExp directly.
  */
 
-class CompoundExp : public Expression {
+class NegateExp : public Expression {
 
 public:
 
 /*
- * Constructor: CompoundExp
- * Usage: Expression *exp = new CompoundExp(op, lhs, rhs);
- * -------------------------------------------------------
- * The constructor initializes a new compound expression
- * which is composed of the operator (op) and the left and
- * right subexpression (lhs and rhs).
+ * Constructor: NegateExp
+ * Usage: Expression *exp = new (arena) NegateExp(operand);
+ * --------------------------------------------------------
+ * The constructor initializes a new expression whose value is the
+ * negation of operand.
  */
 
-    CompoundExp(std::string op, Expression *lhs, Expression *rhs);
+    NegateExp(Expression *operand);
 
 /*
  * Prototypes for the virtual methods
@@ -254,17 +314,62 @@ public:
  * base class and don't require additional documentation.
  */
 
-    virtual ~CompoundExp();
-
     virtual int eval(EvalState &state);
 
     virtual std::string toString();
 
     virtual ExpressionType getType();
 
+    virtual bool hasEffects();
+
+/*
+ * Method: getOperand
+ * Usage: Expression *operand = ((NegateExp *) exp)->getOperand();
+ * ---------------------------------------------------------------
+ * Returns the expression being negated and can be applied only to an
+ * object known to be a NegateExp.
+ */
+
+    Expression *getOperand();
+
+private:
+
+    Expression *operand;
+    bool effects;
+
+};
+
+/*
+ * Class: CompoundExp
+ * ------------------
+ * This subclass represents a compound expression consisting of
+ * two subexpressions joined by an operator.  CompoundExp itself is
+ * abstract: each operator has its own subclass whose eval applies that
+ * operator directly.  Clients create nodes with newCompoundExp.
+ */
+
+class CompoundExp : public Expression {
+
+public:
+
+/*
+ * Prototypes for the virtual methods
+ * ----------------------------------
+ * These methods have the same prototypes as those in the Expression
+ * base class and don't require additional documentation.
+ */
+
+    virtual int eval(EvalState &state) = 0;
+
+    virtual std::string toString();
+
+    virtual ExpressionType getType();
+
+    virtual bool hasEffects();
+
 /*
  * Methods: getOp, getLHS, getRHS
- * Usage: string op = ((CompoundExp *) exp)->getOp();
+ * Usage: Operator op = ((CompoundExp *) exp)->getOp();
  *        Expression *lhs = ((CompoundExp *) exp)->getLHS();
  *        Expression *rhs = ((CompoundExp *) exp)->getRHS();
  * ---------------------------------------------------------
@@ -272,17 +377,70 @@ public:
  * be applied only to an object known to be a CompoundExp.
  */
 
-    std::string getOp();
+    Operator getOp();
 
     Expression *getLHS();
 
     Expression *getRHS();
-private:
 
-    std::string op;
+protected:
+
+    CompoundExp(Operator op, Expression *lhs, Expression *rhs);
+
+    Operator op;
     Expression *lhs, *rhs;
+    bool effects;
+
+};
 
+/*
+ * Classes: AssignExp, AddExp, SubExp, MulExp, DivExp
+ * --------------------------------------------------
+ * The concrete compound expressions, one per operator.
+ */
+
+class AssignExp : public CompoundExp {
+public:
+    AssignExp(Expression *lhs, Expression *rhs);
+    virtual int eval(EvalState &state);
+private:
+    int varId = -1;                   /* ID of the variable assigned */
+    const char *message = nullptr;    /* Error if lhs is not one     */
+};
+
+class AddExp : public CompoundExp {
+public:
+    AddExp(Expression *lhs, Expression *rhs);
+    virtual int eval(EvalState &state);
+};
+
+class SubExp : public CompoundExp {
+public:
+    SubExp(Expression *lhs, Expression *rhs);
+    virtual int eval(EvalState &state);
 };
 
+class MulExp : public CompoundExp {
+public:
+    MulExp(Expression *lhs, Expression *rhs);
+    virtual int eval(EvalState &state);
+};
+
+class DivExp : public CompoundExp {
+public:
+    DivExp(Expression *lhs, Expression *rhs);
+    virtual int eval(EvalState &state);
+};
+
+/*
+ * Function: newCompoundExp
+ * Usage: Expression *exp = newCompoundExp(op, lhs, rhs, arena);
+ * -------------------------------------------------------------
+ * Allocates in arena the compound expression subclass for op, joining
+ * the left and right subexpressions (lhs and rhs).
+ */
+
+CompoundExp *newCompoundExp(Operator op, Expression *lhs, Expression *rhs, Arena &arena);
+
 #endif
 
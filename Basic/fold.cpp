@@ -0,0 +1,193 @@
+/*
+ * File: fold.cpp
+ * --------------
+ * This file implements foldConstants.
+ */
+
+#include <climits>
+#include <vector>
+#include "fold.hpp"
+
+
+/*
+ * Implementation notes: foldConstants
+ * -----------------------------------
+ * The tree is folded bottom up.  Every back end evaluates the operators
+ * with the wrapping arithmetic of the machine, so constants are combined
+ * in unsigned arithmetic, which wraps in the same way.  The rewrites are
+ * limited to those that cannot change what the user sees:
+ *
+ *   c1 op c2          -> its value, unless op is / and the division
+ *                        would fail, so DIVIDE BY ZERO is still raised
+ *                        when the line runs
+ *   -c                -> its value
+ *   -(-e)             -> e
+ *   0 - e             -> -e
+ *   e + 0, 0 + e,
+ *   e - 0, e * 1,
+ *   1 * e, e / 1      -> e
+ *   a + (-b)          -> a - b
+ *   a - (-b)          -> a + b
+ *   (e +- c1) +- c2   -> e + c or e - c, or e when c is 0
+ *
+ * In each case every operand that is not a constant is still evaluated,
+ * in the same order, so undefined variables and assignments behave as
+ * before.  That is also why e * 0 is left alone unless e is a constant:
+ * at load time there is no way to tell whether e will be defined.  The
+ * left operand of an assignment is never touched, since its errors
+ * depend on it being exactly what was written.
+ */
+
+static bool isConstant(Expression *exp, int value) {
+    return exp->getType() == CONSTANT && ((ConstantExp *) exp)->getValue() == value;
+}
+
+static Expression *operandOf(Expression *exp) {
+    return ((NegateExp *) exp)->getOperand();
+}
+
+static Expression *negate(Expression *operand, Arena &arena) {
+    if (operand->getType() == CONSTANT) {
+        return new (arena) ConstantExp(int(0u - unsigned(((ConstantExp *) operand)->getValue())));
+    }
+    if (operand->getType() == NEGATE) return operandOf(operand);
+    return new (arena) NegateExp(operand);
+}
+
+static bool foldOperator(Operator op, int left, int right, int &result) {
+    switch (op) {
+        case ADD_OP: result = int(unsigned(left) + unsigned(right)); return true;
+        case SUB_OP: result = int(unsigned(left) - unsigned(right)); return true;
+        case MUL_OP: result = int(unsigned(left) * unsigned(right)); return true;
+        case DIV_OP:
+            if (right == 0 || (left == INT_MIN && right == -1)) return false;
+            result = left / right;
+            return true;
+        default: return false;
+    }
+}
+
+/*
+ * Returns e + k in the form that reads most naturally, which is e - -k
+ * when k is negative.
+ */
+
+static Expression *addConstant(Expression *exp, int k, Arena &arena) {
+    if (k == 0) return exp;
+    if (k < 0 && k != INT_MIN) return newCompoundExp(SUB_OP, exp, new (arena) ConstantExp(-k), arena);
+    return newCompoundExp(ADD_OP, exp, new (arena) ConstantExp(k), arena);
+}
+
+static Expression *simplify(Operator op, Expression *lhs, Expression *rhs, Arena &arena) {
+    if (lhs->getType() == CONSTANT && rhs->getType() == CONSTANT) {
+        int value;
+        if (foldOperator(op, ((ConstantExp *) lhs)->getValue(), ((ConstantExp *) rhs)->getValue(), value)) {
+            return new (arena) ConstantExp(value);
+        }
+        return nullptr;
+    }
+    switch (op) {
+        case ADD_OP:
+            if (isConstant(rhs, 0)) return lhs;
+            if (isConstant(lhs, 0)) return rhs;
+            if (rhs->getType() == NEGATE) return newCompoundExp(SUB_OP, lhs, operandOf(rhs), arena);
+            break;
+        case SUB_OP:
+            if (isConstant(rhs, 0)) return lhs;
+            if (isConstant(lhs, 0)) return negate(rhs, arena);
+            if (rhs->getType() == NEGATE) return newCompoundExp(ADD_OP, lhs, operandOf(rhs), arena);
+            break;
+        case MUL_OP:
+            if (isConstant(rhs, 1)) return lhs;
+            if (isConstant(lhs, 1)) return rhs;
+            break;
+        case DIV_OP:
+            if (isConstant(rhs, 1)) return lhs;
+            break;
+        default:
+            break;
+    }
+    if ((op == ADD_OP || op == SUB_OP) && rhs->getType() == CONSTANT && lhs->getType() == COMPOUND) {
+        auto *inner = (CompoundExp *) lhs;
+        Operator innerOp = inner->getOp();
+        if ((innerOp == ADD_OP || innerOp == SUB_OP) && inner->getRHS()->getType() == CONSTANT) {
+            unsigned c1 = ((ConstantExp *) inner->getRHS())->getValue();
+            unsigned c2 = ((ConstantExp *) rhs)->getValue();
+            unsigned k = (innerOp == ADD_OP ? c1 : 0 - c1) + (op == ADD_OP ? c2 : 0 - c2);
+            return addConstant(inner->getLHS(), int(k), arena);
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * The walk is post-order with an explicit stack, as in parseLoop, so a
+ * deeply nested expression cannot overflow the C++ stack.  A node is
+ * pushed once to have its operands folded and again, marked expanded,
+ * to combine their results, which are kept on a second stack.  The
+ * left operand is folded before the right one.
+ */
+
+struct FoldFrame {
+    Expression *exp;
+    bool expanded;
+};
+
+static std::vector<FoldFrame> pending;
+static std::vector<Expression *> results;
+
+static Expression *popResult() {
+    Expression *exp = results.back();
+    results.pop_back();
+    return exp;
+}
+
+static Expression *foldNegation(Expression *exp, Expression *operand, Arena &arena) {
+    if (operand == operandOf(exp) && operand->getType() != CONSTANT && operand->getType() != NEGATE) {
+        return exp;
+    }
+    return negate(operand, arena);
+}
+
+static Expression *foldCompound(CompoundExp *compound, Expression *lhs, Expression *rhs, Arena &arena) {
+    Operator op = compound->getOp();
+    Expression *result = simplify(op, lhs, rhs, arena);
+    if (result != nullptr) return result;
+    if (lhs == compound->getLHS() && rhs == compound->getRHS()) return compound;
+    return newCompoundExp(op, lhs, rhs, arena);
+}
+
+Expression *foldConstants(Expression *exp, Arena &arena) {
+    pending.clear();
+    results.clear();
+    pending.push_back({exp, false});
+    while (!pending.empty()) {
+        FoldFrame frame = pending.back();
+        pending.pop_back();
+        Expression *node = frame.exp;
+        if (node->getType() == NEGATE) {
+            if (frame.expanded) {
+                Expression *operand = popResult();
+                results.push_back(foldNegation(node, operand, arena));
+            } else {
+                pending.push_back({node, true});
+                pending.push_back({operandOf(node), false});
+            }
+        } else if (node->getType() == COMPOUND) {
+            auto *compound = (CompoundExp *) node;
+            bool assignment = compound->getOp() == ASSIGN_OP;
+            if (frame.expanded) {
+                Expression *rhs = popResult();
+                Expression *lhs = assignment ? compound->getLHS() : popResult();
+                results.push_back(foldCompound(compound, lhs, rhs, arena));
+            } else {
+                pending.push_back({node, true});
+                pending.push_back({compound->getRHS(), false});
+                if (!assignment) pending.push_back({compound->getLHS(), false});
+            }
+        } else {
+            results.push_back(node);
+        }
+    }
+    return popResult();
+}
@@ -0,0 +1,28 @@
+/*
+ * File: fold.h
+ * ------------
+ * This interface exports foldConstants, which simplifies an expression
+ * tree once, when its line is parsed, so that no back end has to work
+ * out the constant parts of an expression every time it runs.
+ */
+
+#ifndef _fold_h
+#define _fold_h
+
+#include "exp.hpp"
+
+/*
+ * Function: foldConstants
+ * Usage: exp = foldConstants(exp, arena);
+ * ---------------------------------------
+ * Returns an expression that computes the same value as exp, with the
+ * same side effects and errors in the same order, but with every
+ * operator whose operands are constants replaced by its value and a
+ * few identities applied.  New nodes are allocated in arena, which
+ * must be the arena that holds exp; the nodes of exp are left as they
+ * are, but may be shared by the result.
+ */
+
+Expression *foldConstants(Expression *exp, Arena &arena);
+
+#endif
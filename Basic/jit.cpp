@@ -0,0 +1,473 @@
+/*
+ * File: jit.cpp
+ * -------------
+ * This file implements the NativeCode class.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "jit.hpp"
+#include "cfg.hpp"
+
+#if defined(BASIC_ENABLE_JIT) && defined(__x86_64__) && defined(__unix__)
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+/*
+ * Implementation notes: code layout
+ * ---------------------------------
+ * The generated function has the C signature
+ *
+ *     int code(int *frame, const void *entry);
+ *
+ * Its prologue saves the callee-saved registers it uses, loads the
+ * frame address into rbx and jumps to entry, which is the address of
+ * any line of the program.  Expressions are evaluated into eax, with
+ * pending left operands saved on the machine stack.  Every way out of
+ * the program jumps to a small stub that loads the index of its Exit
+ * into eax and continues to the shared epilogue, which resets rsp from
+ * rbp so that errors raised in the middle of an expression are safe.
+ *
+ * The frame holds one int per variable, followed by one byte per
+ * variable that records whether it is defined.  Every variable is
+ * collected before any code is emitted, so the offset of the defined
+ * bytes is fixed by frameVars and must not change during emission.
+ *
+ * Code generation recurses once per level of an expression, and the
+ * generated code pushes a pending operand per level, so collect also
+ * measures the depth of every expression.  If one is nested more than
+ * MAX_EXP_DEPTH deep, the constructor gives up before emitting
+ * anything and the object is left empty.
+ */
+
+NativeCode::NativeCode(Program &program) {
+#ifdef JIT_SUPPORTED
+    std::vector<BasicBlock> &blocks = program.getControlFlowGraph().getBlocks();
+    for (BasicBlock &block : blocks) {
+        for (Statement *stmt : block.statements) {
+            switch (stmt->getType()) {
+                case LET_STMT:
+                    variable(((LetStmt *) stmt)->getVarId());
+                    if (!collect(((LetStmt *) stmt)->getExp())) return;
+                    break;
+                case PRINT_STMT:
+                    if (!collect(((PrintStmt *) stmt)->getExp())) return;
+                    break;
+                case INPUT_STMT:
+                    variable(((InputStmt *) stmt)->getVarId());
+                    break;
+                case IF_STMT:
+                    if (!collect(((IfStmt *) stmt)->getLHS())) return;
+                    if (!collect(((IfStmt *) stmt)->getRHS())) return;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    frameVars = int(vars.size());
+
+    /* Prologue: push rbp; mov rbp, rsp; push rbx; push r12 */
+    emit8(0x55);
+    emit8(0x48), emit8(0x89), emit8(0xE5);
+    emit8(0x53);
+    emit8(0x41), emit8(0x54);
+    /* mov rbx, rdi; jmp rsi */
+    emit8(0x48), emit8(0x89), emit8(0xFB);
+    emit8(0xFF), emit8(0xE6);
+
+    epilogue = newLabel();
+    undefinedExit = exitLabel({EXIT_ERROR, "VARIABLE NOT DEFINED", nullptr, -1});
+    divideExit = exitLabel({EXIT_ERROR, "DIVIDE BY ZERO", nullptr, -1});
+    haltExit = exitLabel({EXIT_HALT, "", nullptr, -1});
+
+    for (BasicBlock &block : blocks) {
+        for (int line : block.lines) lineLabels[line] = newLabel();
+    }
+    entry = lineLabels.empty() ? haltExit : lineLabels.begin()->second;
+    for (auto it = lineLabels.begin(); it != lineLabels.end(); ++it) {
+        auto next = std::next(it);
+        bind(it->second);
+        compileStatement(program.getParsedStatement(it->first),
+                         next == lineLabels.end() ? haltExit : next->second);
+    }
+    emitJump(0xE9, haltExit);
+
+    for (auto &stub : stubs) {
+        bind(stub.first);
+        emit8(0xB8), emit32(stub.second);
+        emitJump(0xE9, epilogue);
+    }
+
+    /* Epilogue: lea rsp, [rbp - 16]; pop r12; pop rbx; pop rbp; ret */
+    bind(epilogue);
+    emit8(0x48), emit8(0x8D), emit8(0x65), emit8(0xF0);
+    emit8(0x41), emit8(0x5C);
+    emit8(0x5B);
+    emit8(0x5D);
+    emit8(0xC3);
+
+    assert(int(vars.size()) == frameVars);
+    for (auto &fixup : fixups) {
+        int rel = labels[fixup.second] - (fixup.first + 4);
+        std::memcpy(&buffer[fixup.first], &rel, 4);
+    }
+    if (!install()) memory = nullptr;
+    buffer.clear();
+#endif
+}
+
+NativeCode::~NativeCode() {
+#ifdef JIT_SUPPORTED
+    if (memory != nullptr) munmap(memory, size);
+#endif
+}
+
+bool NativeCode::isCompiled() {
+    return memory != nullptr;
+}
+
+/*
+ * Implementation notes: install
+ * -----------------------------
+ * The code is copied into pages that are writable only until the copy
+ * is done and executable only afterwards.
+ */
+
+bool NativeCode::install() {
+#ifdef JIT_SUPPORTED
+    size_t page = sysconf(_SC_PAGESIZE);
+    size = (buffer.size() + page - 1) / page * page;
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return false;
+    std::memcpy(p, buffer.data(), buffer.size());
+    if (mprotect(p, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(p, size);
+        return false;
+    }
+    memory = (unsigned char *) p;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * Calls the machine code repeatedly: once from the first line, and
+ * again after each statement that run had to execute itself.  The
+ * return stack holds the labels of return points, so a GOSUB or RETURN
+ * costs one exit and one re-entry and no search.
+ */
+
+static void printValue(int value) {
+    std::cout << value << '\n';
+}
+
+void NativeCode::run(EvalState &state, Program &program, int lineNumber,
+                     const std::vector<int> &returnLines) {
+    if (memory == nullptr) error("JIT is not available");
+    int n = frameVars;
+    std::vector<int> frame(n + (n + 3) / 4);
+    char *defined = (char *) (frame.data() + n);
+    auto load = [&]() {
+        for (int i = 0; i < n; i++) {
+            defined[i] = state.isDefined(vars[i]);
+            if (defined[i]) frame[i] = state.getValue(vars[i]);
+        }
+    };
+    auto writeBack = [&]() {
+        for (int i = 0; i < n; i++) {
+            if (defined[i]) state.setValue(vars[i], frame[i]);
+        }
+    };
+    auto code = (int (*)(int *, const void *)) memory;
+    const void *address = memory + labels[lineNumber == -1 ? entry : lineLabels.at(lineNumber)];
+    returns.clear();
+    for (int line : returnLines) returns.push(line == -1 ? haltExit : lineLabels.at(line));
+    load();
+    while (true) {
+        Exit &exit = exits[code(frame.data(), address)];
+        switch (exit.kind) {
+            case EXIT_HALT:
+                writeBack();
+                return;
+            case EXIT_LINE_ERROR:
+                writeBack();
+                std::cout << "LINE NUMBER ERROR\n";
+                return;
+            case EXIT_ERROR:
+                writeBack();
+                error(exit.message);
+                break;
+            case EXIT_INTERPRET:
+                writeBack();
+                exit.stmt->execute(state, program);
+                load();
+                address = memory + labels[exit.resume];
+                break;
+            case EXIT_GOSUB:
+                try {
+                    returns.push(exit.resume);
+                } catch (ErrorException &ex) {
+                    writeBack();
+                    throw;
+                }
+                address = memory + labels[exit.target];
+                break;
+            case EXIT_RETURN:
+                try {
+                    address = memory + labels[returns.pop()];
+                } catch (ErrorException &ex) {
+                    writeBack();
+                    throw;
+                }
+                break;
+        }
+    }
+}
+
+int NativeCode::variable(int id) {
+    if (size_t(id) >= slots.size()) slots.resize(id + 1, -1);
+    if (slots[id] != -1) return slots[id];
+    vars.push_back(id);
+    return slots[id] = int(vars.size()) - 1;
+}
+
+bool NativeCode::collect(Expression *exp, int depth) {
+    if (depth > MAX_EXP_DEPTH) return false;
+    if (exp->getType() == IDENTIFIER) {
+        variable(((IdentifierExp *) exp)->getId());
+    } else if (exp->getType() == NEGATE) {
+        return collect(((NegateExp *) exp)->getOperand(), depth + 1);
+    } else if (exp->getType() == COMPOUND) {
+        return collect(((CompoundExp *) exp)->getLHS(), depth + 1)
+               && collect(((CompoundExp *) exp)->getRHS(), depth + 1);
+    }
+    return true;
+}
+
+/*
+ * Implementation notes: assembler helpers
+ * ---------------------------------------
+ * Labels are indices into labels, bound to an offset in buffer once
+ * known.  Every branch uses a rel32 displacement that is recorded in
+ * fixups and patched when the code is complete.
+ */
+
+int NativeCode::newLabel() {
+    labels.push_back(-1);
+    return int(labels.size()) - 1;
+}
+
+void NativeCode::bind(int label) {
+    labels[label] = int(buffer.size());
+}
+
+int NativeCode::exitLabel(const Exit &exit) {
+    exits.push_back(exit);
+    int label = newLabel();
+    stubs.emplace_back(label, int(exits.size()) - 1);
+    return label;
+}
+
+void NativeCode::emit8(int byte) {
+    buffer.push_back((unsigned char) byte);
+}
+
+void NativeCode::emit32(int value) {
+    for (int i = 0; i < 4; i++) emit8((value >> (8 * i)) & 0xFF);
+}
+
+/*
+ * Emits a jmp (0xE9) or, for any other value, the two-byte conditional
+ * jump 0x0F opcode, followed by a rel32 to label.
+ */
+
+void NativeCode::emitJump(int opcode, int label) {
+    if (opcode == 0xE9) {
+        emit8(0xE9);
+    } else {
+        emit8(0x0F), emit8(opcode);
+    }
+    fixups.emplace_back(int(buffer.size()), label);
+    emit32(0);
+}
+
+/*
+ * Emits opcode with a ModRM byte addressing [rbx + disp32], where reg
+ * is the register field (0 for eax, 1 for ecx) and disp32 selects the
+ * value of the variable in slot.
+ */
+
+void NativeCode::emitValueAccess(int opcode, int reg, int slot) {
+    emit8(opcode);
+    emit8(0x83 | (reg << 3));
+    emit32(4 * slot);
+}
+
+/* cmp byte [rbx + defined], 0; je undefinedExit */
+
+void NativeCode::emitCheckDefined(int slot) {
+    emit8(0x80), emit8(0xBB), emit32(4 * frameVars + slot), emit8(0x00);
+    emitJump(0x84, undefinedExit);
+}
+
+/* mov byte [rbx + defined], 1 */
+
+void NativeCode::emitSetDefined(int slot) {
+    emit8(0xC6), emit8(0x83), emit32(4 * frameVars + slot), emit8(0x01);
+}
+
+/*
+ * Implementation notes: compileStatement
+ * --------------------------------------
+ * next is the label of the following line, used as the continuation of
+ * statements that are handed back to the interpreter.
+ */
+
+void NativeCode::compileStatement(Statement *stmt, int next) {
+    switch (stmt->getType()) {
+        case REM_STMT:
+            break;
+        case LET_STMT: {
+            auto *let = (LetStmt *) stmt;
+            int slot = variable(let->getVarId());
+            compileExp(let->getExp());
+            emitValueAccess(0x89, 0, slot);
+            emitSetDefined(slot);
+            break;
+        }
+        case PRINT_STMT:
+            compileExp(((PrintStmt *) stmt)->getExp());
+            /* mov edi, eax; mov rax, printValue; call rax */
+            emit8(0x89), emit8(0xC7);
+            emit8(0x48), emit8(0xB8);
+            for (int i = 0; i < 8; i++) emit8((uint64_t(&printValue) >> (8 * i)) & 0xFF);
+            emit8(0xFF), emit8(0xD0);
+            break;
+        case END_STMT:
+            emitJump(0xE9, exitLabel({EXIT_HALT, "", nullptr, -1}));
+            break;
+        case GOTO_STMT:
+        case IF_STMT: {
+            int opcode = 0xE9;
+            int target = stmt->getType() == GOTO_STMT ? ((GotoStmt *) stmt)->getLineNumber()
+                                                      : ((IfStmt *) stmt)->getLineNumber();
+            if (stmt->getType() == IF_STMT) {
+                auto *ifStmt = (IfStmt *) stmt;
+                compileOperands(ifStmt->getLHS(), ifStmt->getRHS());
+                emit8(0x39), emit8(0xC8);                  /* cmp eax, ecx */
+                switch (ifStmt->getComparison()) {
+                    case LT_CMP: opcode = 0x8C; break;     /* jl */
+                    case EQ_CMP: opcode = 0x84; break;     /* je */
+                    case GT_CMP: opcode = 0x8F; break;     /* jg */
+                }
+            }
+            auto it = lineLabels.find(target);
+            emitJump(opcode, it != lineLabels.end() ? it->second
+                                                    : exitLabel({EXIT_LINE_ERROR, "", nullptr, -1}));
+            break;
+        }
+        case GOSUB_STMT: {
+            auto it = lineLabels.find(((GosubStmt *) stmt)->getLineNumber());
+            int target = it != lineLabels.end() ? it->second : exitLabel({EXIT_LINE_ERROR, "", nullptr, -1});
+            emitJump(0xE9, exitLabel({EXIT_GOSUB, "", nullptr, next, target}));
+            break;
+        }
+        case RETURN_STMT:
+            emitJump(0xE9, exitLabel({EXIT_RETURN, "", nullptr, -1}));
+            break;
+        default:
+            emitJump(0xE9, exitLabel({EXIT_INTERPRET, "", stmt, next}));
+            break;
+    }
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * Leaves the value of exp in eax.  Assignments are checked as in
+ * CompoundExp::eval, with any error compiled into an exit.
+ */
+
+void NativeCode::compileExp(Expression *exp) {
+    if (exp->getType() == CONSTANT) {
+        emit8(0xB8), emit32(((ConstantExp *) exp)->getValue());
+        return;
+    }
+    if (exp->getType() == IDENTIFIER) {
+        int slot = variable(((IdentifierExp *) exp)->getId());
+        emitCheckDefined(slot);
+        emitValueAccess(0x8B, 0, slot);
+        return;
+    }
+    if (exp->getType() == NEGATE) {
+        compileExp(((NegateExp *) exp)->getOperand());
+        emit8(0xF7), emit8(0xD8);                          /* neg eax */
+        return;
+    }
+    auto *compound = (CompoundExp *) exp;
+    Operator op = compound->getOp();
+    Expression *lhs = compound->getLHS();
+    if (op == ASSIGN_OP) {
+        if (lhs->getType() != IDENTIFIER) {
+            emitJump(0xE9, exitLabel({EXIT_ERROR, "Illegal variable in assignment", nullptr, -1}));
+        } else if (lhs->toString() == "LET") {
+            emitJump(0xE9, exitLabel({EXIT_ERROR, "SYNTAX ERROR", nullptr, -1}));
+        } else {
+            int slot = variable(((IdentifierExp *) lhs)->getId());
+            compileExp(compound->getRHS());
+            emitValueAccess(0x89, 0, slot);
+            emitSetDefined(slot);
+        }
+        return;
+    }
+    compileOperands(lhs, compound->getRHS());
+    compileOperator(op);
+}
+
+/*
+ * Implementation notes: compileOperands
+ * -------------------------------------
+ * Leaves lhs in eax and rhs in ecx, evaluating lhs first.  Constants
+ * and variables are loaded straight into ecx; anything else needs the
+ * left value saved on the stack while it is evaluated.
+ */
+
+void NativeCode::compileOperands(Expression *lhs, Expression *rhs) {
+    compileExp(lhs);
+    if (rhs->getType() == CONSTANT) {
+        emit8(0xB9), emit32(((ConstantExp *) rhs)->getValue());
+    } else if (rhs->getType() == IDENTIFIER) {
+        int slot = variable(((IdentifierExp *) rhs)->getId());
+        emitCheckDefined(slot);
+        emitValueAccess(0x8B, 1, slot);
+    } else {
+        emit8(0x50);                                       /* push rax */
+        compileExp(rhs);
+        emit8(0x89), emit8(0xC1);                          /* mov ecx, eax */
+        emit8(0x58);                                       /* pop rax */
+    }
+}
+
+void NativeCode::compileOperator(Operator op) {
+    if (op == ADD_OP) {
+        emit8(0x01), emit8(0xC8);                          /* add eax, ecx */
+    } else if (op == SUB_OP) {
+        emit8(0x29), emit8(0xC8);                          /* sub eax, ecx */
+    } else if (op == MUL_OP) {
+        emit8(0x0F), emit8(0xAF), emit8(0xC1);             /* imul eax, ecx */
+    } else if (op == DIV_OP) {
+        emit8(0x85), emit8(0xC9);                          /* test ecx, ecx */
+        emitJump(0x84, divideExit);
+        emit8(0x99);                                       /* cdq */
+        emit8(0xF7), emit8(0xF9);                          /* idiv ecx */
+    }
+}
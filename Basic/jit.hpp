@@ -0,0 +1,164 @@
+/*
+ * File: jit.h
+ * -----------
+ * This interface exports the NativeCode class, which translates a BASIC
+ * program into x86-64 machine code and runs it.  It is selected with
+ * RUN JIT and is only built when BASIC_ENABLE_JIT is defined on an
+ * x86-64 Unix system; elsewhere isCompiled always returns false and the
+ * caller falls back to one of the interpreters.
+ */
+
+#ifndef _jit_h
+#define _jit_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include "evalstate.hpp"
+#include "exp.hpp"
+#include "statement.hpp"
+#include "program.hpp"
+#include "returnstack.hpp"
+
+/*
+ * Class: NativeCode
+ * -----------------
+ * A Program compiled to machine code.  Variables live in a dense frame
+ * of ints followed by one definedness byte per variable, addressed off
+ * a single base register.  LET, PRINT, GOTO, IF, END and REM are
+ * translated directly.  GOSUB and RETURN exit back to run, which keeps
+ * the return stack as a list of labels and re-enters the machine code
+ * at the label it pushes or pops.  Any other statement, such as INPUT,
+ * becomes an exit back to run, which executes it with
+ * Statement::execute and then re-enters the machine code at the
+ * following line.
+ */
+
+class NativeCode {
+
+public:
+
+/*
+ * Constructor: NativeCode
+ * Usage: NativeCode native(program);
+ * ----------------------------------
+ * Compiles program into a freshly mapped executable page.  If machine
+ * code cannot be generated on this platform, or if an expression is
+ * nested more than MAX_EXP_DEPTH deep, the object is left empty.  RUN
+ * JIT and runTiered then run the program with RegisterVM, whose
+ * compile time is linear in the depth of an expression.
+ */
+
+    NativeCode(Program &program);
+
+/*
+ * Destructor: ~NativeCode
+ * Usage: usually implicit
+ * -----------------------
+ * Unmaps the generated code.
+ */
+
+    ~NativeCode();
+
+/*
+ * Method: isCompiled
+ * Usage: if (native.isCompiled()) . . .
+ * -------------------------------------
+ * Returns true if machine code was generated and run may be called.
+ */
+
+    bool isCompiled();
+
+/*
+ * Method: run
+ * Usage: native.run(state, program);
+ *        native.run(state, program, lineNumber, returnLines);
+ * -----------------------------------------------------------
+ * Executes the compiled program.  Variables are read from state on
+ * entry and written back on exit, as with the other back ends.  If a
+ * line number is given, execution starts at that line, with the GOSUB
+ * calls in progress given by returnLines as for RegisterVM::run.
+ */
+
+    void run(EvalState &state, Program &program, int lineNumber = -1,
+             const std::vector<int> &returnLines = {});
+
+private:
+
+/*
+ * Private type: Exit
+ * ------------------
+ * Describes one way of leaving the machine code.  The generated
+ * function returns the index of the exit it took.
+ */
+
+    enum ExitKind {
+        EXIT_HALT, EXIT_LINE_ERROR, EXIT_ERROR, EXIT_INTERPRET,
+        EXIT_GOSUB, EXIT_RETURN
+    };
+
+    struct Exit {
+        ExitKind kind;
+        std::string message;       /* For EXIT_ERROR                 */
+        Statement *stmt;           /* For EXIT_INTERPRET             */
+        int resume;                /* Label to continue at afterwards */
+        int target = -1;           /* For EXIT_GOSUB, the subroutine */
+    };
+
+    static constexpr int MAX_EXP_DEPTH = 1000;
+
+    unsigned char *memory = nullptr;     /* The mapped machine code    */
+    size_t size = 0;                     /* Size of the mapping        */
+    std::vector<unsigned char> buffer;   /* Code being assembled       */
+    std::vector<int> labels;             /* Offsets of labels          */
+    std::vector<std::pair<int, int>> fixups; /* rel32 fields and labels */
+    std::vector<Exit> exits;             /* Exits by index             */
+    std::vector<std::pair<int, int>> stubs; /* Exit labels and indices */
+    std::vector<int> vars;               /* Variable IDs by slot       */
+    std::vector<int> slots;              /* Variable slots by ID       */
+    int frameVars = -1;                  /* Variables in the frame     */
+    std::map<int, int> lineLabels;       /* Label of each line         */
+    int entry = -1;                      /* Label of the first line    */
+    int epilogue = -1;                   /* Label of the return path   */
+    int undefinedExit = -1;              /* Raises VARIABLE NOT DEFINED */
+    int divideExit = -1;                 /* Raises DIVIDE BY ZERO      */
+    int haltExit = -1;                   /* Stops the program          */
+    ReturnStack returns;                 /* Labels to RETURN to        */
+
+/* Private method prototypes */
+
+    int variable(int id);
+
+    bool collect(Expression *exp, int depth = 0);
+
+    int newLabel();
+
+    void bind(int label);
+
+    int exitLabel(const Exit &exit);
+
+    void emit8(int byte);
+
+    void emit32(int value);
+
+    void emitJump(int opcode, int label);
+
+    void emitValueAccess(int opcode, int reg, int slot);
+
+    void emitCheckDefined(int slot);
+
+    void emitSetDefined(int slot);
+
+    void compileStatement(Statement *stmt, int next);
+
+    void compileExp(Expression *exp);
+
+    void compileOperands(Expression *lhs, Expression *rhs);
+
+    void compileOperator(Operator op);
+
+    bool install();
+
+};
+
+#endif
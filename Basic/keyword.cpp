@@ -0,0 +1,60 @@
+/*
+ * File: keyword.cpp
+ * -----------------
+ * This file implements the keyword table.
+ */
+
+#include <array>
+#include "keyword.hpp"
+
+
+/*
+ * Implementation notes: the keyword table
+ * ---------------------------------------
+ * The table is indexed by a perfect hash of the first character, the
+ * last character and the length of a word, so a lookup costs one hash
+ * and at most one string comparison.  The multiplier was chosen by
+ * hand so that no two keywords share a slot; the static_assert below
+ * rejects any change to the keyword list that breaks that property.
+ */
+
+static const int TABLE_SIZE = 64;
+
+struct KeywordEntry {
+    std::string_view name;
+    Keyword id;
+};
+
+static constexpr KeywordEntry KEYWORDS[] = {
+    {"REM", REM_KW}, {"LET", LET_KW}, {"PRINT", PRINT_KW}, {"INPUT", INPUT_KW},
+    {"END", END_KW}, {"GOTO", GOTO_KW}, {"IF", IF_KW}, {"THEN", THEN_KW},
+    {"RUN", RUN_KW}, {"LIST", LIST_KW}, {"CLEAR", CLEAR_KW}, {"QUIT", QUIT_KW},
+    {"HELP", HELP_KW}, {"GOSUB", GOSUB_KW}, {"RETURN", RETURN_KW}
+};
+
+static constexpr int hashWord(std::string_view word) {
+    return (3 * (unsigned char) word.front() + (unsigned char) word.back() + int(word.length())) % TABLE_SIZE;
+}
+
+static constexpr std::array<KeywordEntry, TABLE_SIZE> makeTable() {
+    std::array<KeywordEntry, TABLE_SIZE> table = {};
+    for (const KeywordEntry &entry : KEYWORDS) table[hashWord(entry.name)] = entry;
+    return table;
+}
+
+static constexpr std::array<KeywordEntry, TABLE_SIZE> TABLE = makeTable();
+
+static constexpr bool isPerfect() {
+    for (const KeywordEntry &entry : KEYWORDS) {
+        if (TABLE[hashWord(entry.name)].id != entry.id) return false;
+    }
+    return true;
+}
+
+static_assert(isPerfect(), "two keywords hash to the same slot");
+
+Keyword lookupKeyword(std::string_view token) {
+    if (token.empty()) return NO_KEYWORD;
+    const KeywordEntry &entry = TABLE[hashWord(token)];
+    return (entry.name == token) ? entry.id : NO_KEYWORD;
+}
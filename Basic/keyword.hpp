@@ -0,0 +1,42 @@
+/*
+ * File: keyword.h
+ * ---------------
+ * This interface maps the reserved words of BASIC to small integer
+ * IDs, so that commands and statements can be dispatched with a switch
+ * instead of a chain of string comparisons.
+ */
+
+#ifndef _keyword_h
+#define _keyword_h
+
+#include <string_view>
+
+/*
+ * Type: Keyword
+ * -------------
+ * The reserved words, in a dense range starting at one.  NO_KEYWORD is
+ * the ID of every other word.  None of them can be used as a variable
+ * name.  GOSUB and RETURN are reserved like the other statement names,
+ * so that a line such as RETURN = 1 cannot be read as an assignment.
+ * CFG is not listed, since it is only an immediate command and is
+ * matched by name in processLine.
+ */
+
+enum Keyword {
+    NO_KEYWORD,
+    REM_KW, LET_KW, PRINT_KW, INPUT_KW, END_KW, GOTO_KW, IF_KW, THEN_KW,
+    RUN_KW, LIST_KW, CLEAR_KW, QUIT_KW, HELP_KW,
+    GOSUB_KW, RETURN_KW
+};
+
+/*
+ * Function: lookupKeyword
+ * Usage: Keyword id = lookupKeyword(token);
+ * -----------------------------------------
+ * Returns the ID of the reserved word spelled by token, which must be
+ * in upper case, or NO_KEYWORD if token is not a reserved word.
+ */
+
+Keyword lookupKeyword(std::string_view token);
+
+#endif
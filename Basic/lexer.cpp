@@ -0,0 +1,270 @@
+/*
+ * File: lexer.cpp
+ * ---------------
+ * This file implements lexSource.
+ */
+
+#include <cstring>
+#include "lexer.hpp"
+#include "Utils/error.hpp"
+
+#if defined(BASIC_ENABLE_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_SUPPORTED
+#include <immintrin.h>
+#endif
+
+
+/*
+ * Implementation notes: lexSource
+ * -------------------------------
+ * Lexing is done in two passes.  The first classifies every byte of the
+ * text and records the result as three bitmaps, one bit per byte:
+ *
+ *   blank -- whitespace other than '\n'
+ *   digit -- '0' to '9'
+ *   alnum -- a letter or a digit, that is, a word character
+ *
+ * This pass has no branches that depend on the data, so it is done 64
+ * bytes at a time with AVX2 or SSE2 when the processor has them.  The
+ * second pass walks the text token by token, and finds the end of each
+ * run of blanks, digits or word characters by counting the trailing
+ * bits of a bitmap word, so it only ever looks at the first character
+ * of a token and at the few characters that may follow a number.
+ *
+ * Any other character is a token by itself.  Its type is the one that
+ * TokenScanner::getTokenType gives it, which makes a lone '"' a STRING.
+ *
+ * The bitmaps have one more word than the text needs, and the bits for
+ * positions past the end are all zero, so every run ends before the
+ * walk can leave the bitmaps.
+ */
+
+struct Bitmaps {
+    std::vector<uint64_t> blank;
+    std::vector<uint64_t> digit;
+    std::vector<uint64_t> alnum;
+};
+
+typedef void (*ClassifyFn)(const unsigned char *p, size_t blocks, uint64_t *blank,
+                           uint64_t *digit, uint64_t *alnum);
+
+/*
+ * Implementation notes: classifyScalar
+ * ------------------------------------
+ * The portable version, and the reference for the others: '\n' is not
+ * blank, and only ASCII letters and digits are word characters, which
+ * matches the default character classes of TokenScanner.
+ */
+
+static void classifyScalar(const unsigned char *p, size_t blocks, uint64_t *blank,
+                           uint64_t *digit, uint64_t *alnum) {
+    for (size_t b = 0; b < blocks; b++, p += 64) {
+        uint64_t bl = 0, dg = 0, an = 0;
+        for (int i = 0; i < 64; i++) {
+            unsigned char ch = p[i];
+            bool isDigit = (unsigned char) (ch - '0') <= 9;
+            bool isAlpha = (unsigned char) ((ch | 0x20) - 'a') <= 25;
+            bool isBlank = ch == ' ' || (ch >= '\t' && ch <= '\r' && ch != '\n');
+            bl |= uint64_t(isBlank) << i;
+            dg |= uint64_t(isDigit) << i;
+            an |= uint64_t(isDigit || isAlpha) << i;
+        }
+        blank[b] = bl;
+        digit[b] = dg;
+        alnum[b] = an;
+    }
+}
+
+#ifdef SIMD_SUPPORTED
+
+/*
+ * Implementation notes: classifySSE2, classifyAVX2
+ * ------------------------------------------------
+ * A byte lies in the range [lo, lo + n] exactly when (byte - lo),
+ * taken as unsigned, is at most n, which is when min(byte - lo, n)
+ * equals byte - lo.  Each class is one or two such range tests, and
+ * movemask gathers the results into the bitmap words.
+ */
+
+static inline __m128i inRange16(__m128i v, char lo, char n) {
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(n)), t);
+}
+
+static void classifySSE2(const unsigned char *p, size_t blocks, uint64_t *blank,
+                         uint64_t *digit, uint64_t *alnum) {
+    for (size_t b = 0; b < blocks; b++, p += 64) {
+        uint64_t bl = 0, dg = 0, an = 0;
+        for (int i = 0; i < 64; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+            __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), inRange16(v, '\t', 4));
+            space = _mm_andnot_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), space);
+            __m128i dig = inRange16(v, '0', 9);
+            __m128i alpha = inRange16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 25);
+            bl |= uint64_t(uint16_t(_mm_movemask_epi8(space))) << i;
+            dg |= uint64_t(uint16_t(_mm_movemask_epi8(dig))) << i;
+            an |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_or_si128(dig, alpha)))) << i;
+        }
+        blank[b] = bl;
+        digit[b] = dg;
+        alnum[b] = an;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i inRange32(__m256i v, char lo, char n) {
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(n)), t);
+}
+
+__attribute__((target("avx2")))
+static void classifyAVX2(const unsigned char *p, size_t blocks, uint64_t *blank,
+                         uint64_t *digit, uint64_t *alnum) {
+    for (size_t b = 0; b < blocks; b++, p += 64) {
+        uint64_t bl = 0, dg = 0, an = 0;
+        for (int i = 0; i < 64; i += 32) {
+            __m256i v = _mm256_loadu_si256((const __m256i *) (p + i));
+            __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), inRange32(v, '\t', 4));
+            space = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), space);
+            __m256i dig = inRange32(v, '0', 9);
+            __m256i alpha = inRange32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 25);
+            bl |= uint64_t(uint32_t(_mm256_movemask_epi8(space))) << i;
+            dg |= uint64_t(uint32_t(_mm256_movemask_epi8(dig))) << i;
+            an |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_or_si256(dig, alpha)))) << i;
+        }
+        blank[b] = bl;
+        digit[b] = dg;
+        alnum[b] = an;
+    }
+}
+
+#endif
+
+/*
+ * Implementation notes: selectClassifier
+ * --------------------------------------
+ * Chooses the widest version the processor supports, once, falling
+ * back to classifyScalar when it has neither AVX2 nor SSE2 or SIMD is
+ * disabled.
+ */
+
+static ClassifyFn selectClassifier() {
+#ifdef SIMD_SUPPORTED
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return classifyAVX2;
+    if (__builtin_cpu_supports("sse2")) return classifySSE2;
+#endif
+    return classifyScalar;
+}
+
+static void classify(std::string_view text, Bitmaps &maps) {
+    static const ClassifyFn classifier = selectClassifier();
+    size_t words = text.length() / 64 + 1;
+    maps.blank.assign(words, 0);
+    maps.digit.assign(words, 0);
+    maps.alnum.assign(words, 0);
+    auto *p = (const unsigned char *) text.data();
+    size_t full = text.length() / 64;
+    classifier(p, full, maps.blank.data(), maps.digit.data(), maps.alnum.data());
+    unsigned char tail[64] = {};
+    memcpy(tail, p + full * 64, text.length() - full * 64);
+    classifier(tail, 1, &maps.blank[full], &maps.digit[full], &maps.alnum[full]);
+}
+
+/*
+ * Implementation notes: endOfRun
+ * ------------------------------
+ * Returns the first position at or after pos whose bit in map is clear.
+ */
+
+static inline size_t endOfRun(const std::vector<uint64_t> &map, size_t pos) {
+    size_t word = pos / 64;
+    uint64_t bits = ~map[word] >> (pos % 64);
+    if (bits != 0) return pos + __builtin_ctzll(bits);
+    while ((bits = ~map[++word]) == 0) {
+        /* Empty */
+    }
+    return word * 64 + __builtin_ctzll(bits);
+}
+
+static inline bool testBit(const std::vector<uint64_t> &map, size_t pos) {
+    return (map[pos / 64] >> (pos % 64)) & 1;
+}
+
+/*
+ * Implementation notes: estimateTokens
+ * ------------------------------------
+ * Returns roughly how many tokens and newlines the text holds, from the
+ * number of runs of word characters and the number of characters that
+ * are neither blank nor word characters.  Reserving that much space in
+ * advance saves the token array from being copied as it grows, which
+ * otherwise costs about as much as the walk itself.
+ */
+
+static size_t estimateTokens(const Bitmaps &maps) {
+    size_t estimate = 0;
+    uint64_t carry = 0;
+    for (size_t i = 0; i < maps.alnum.size(); i++) {
+        uint64_t word = maps.alnum[i];
+        estimate += __builtin_popcountll(word & ~((word << 1) | carry));
+        estimate += __builtin_popcountll(~(word | maps.blank[i]));
+        carry = word >> 63;
+    }
+    return estimate;
+}
+
+/*
+ * Implementation notes: endOfNumber
+ * ---------------------------------
+ * Follows the same states as TokenScanner::scanNumber: digits, then an
+ * optional fraction, then an optional exponent, which is only part of
+ * the number if at least one digit follows the E and its sign.
+ */
+
+static size_t endOfNumber(std::string_view text, const Bitmaps &maps, size_t pos) {
+    size_t end = endOfRun(maps.digit, pos + 1);
+    if (end < text.length() && text[end] == '.') end = endOfRun(maps.digit, end + 1);
+    if (end < text.length() && (text[end] == 'E' || text[end] == 'e')) {
+        size_t exp = end + 1;
+        if (exp < text.length() && (text[exp] == '+' || text[exp] == '-')) exp++;
+        if (exp < text.length() && testBit(maps.digit, exp)) end = endOfRun(maps.digit, exp + 1);
+    }
+    return end;
+}
+
+void lexSource(std::string_view text, std::vector<SourceToken> &tokens, std::vector<SourceLine> &lines) {
+    if (text.length() > UINT32_MAX) error("Source file too large");
+    Bitmaps maps;
+    classify(text, maps);
+    tokens.reserve(tokens.size() + estimateTokens(maps));
+    size_t lineStart = 0;
+    size_t pos = 0;
+    size_t firstToken = tokens.size();
+    while (true) {
+        pos = endOfRun(maps.blank, pos);
+        if (pos == text.length() || text[pos] == '\n') {
+            if (pos < text.length() || pos > lineStart) {
+                lines.push_back({lineStart, uint32_t(pos - lineStart), uint32_t(firstToken),
+                                 uint32_t(tokens.size() - firstToken)});
+            }
+            if (pos == text.length()) break;
+            lineStart = ++pos;
+            firstToken = tokens.size();
+            continue;
+        }
+        size_t end;
+        TokenType type;
+        if (testBit(maps.digit, pos)) {
+            end = endOfNumber(text, maps, pos);
+            type = NUMBER;
+        } else if (testBit(maps.alnum, pos)) {
+            end = endOfRun(maps.alnum, pos + 1);
+            type = WORD;
+        } else {
+            end = pos + 1;
+            type = (text[pos] == '"') ? STRING : OPERATOR;
+        }
+        tokens.push_back({uint32_t(pos - lineStart), uint32_t(end - pos), type});
+        pos = end;
+    }
+}
@@ -0,0 +1,48 @@
+/*
+ * File: lexer.h
+ * -------------
+ * This interface exports lexSource, which splits a whole BASIC source
+ * file into lines and tokens in a single pass.  It is used when a
+ * program is loaded from a file, where scanning one line at a time
+ * through a TokenScanner would dominate the load.
+ */
+
+#ifndef _lexer_h
+#define _lexer_h
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Utils/tokenScanner.hpp"
+
+/*
+ * Type: SourceLine
+ * ----------------
+ * One line of a lexed source: the position and length of its text,
+ * without the newline, and the range of its tokens in the token array.
+ */
+
+struct SourceLine {
+    size_t offset;
+    uint32_t length;
+    uint32_t firstToken;
+    uint32_t tokenCount;
+};
+
+/*
+ * Function: lexSource
+ * Usage: lexSource(text, tokens, lines);
+ * --------------------------------------
+ * Appends every token of text to tokens and every line to lines.  The
+ * offset of each token is relative to the start of its line, so a line
+ * and its tokens can be handed to TokenScanner::setInputTokens as they
+ * are.  The tokens are exactly those a TokenScanner configured with
+ * ignoreWhitespace and scanNumbers returns for each line, as processLine
+ * and Program::addSourceLine use it.  Lines end at '\n' only, as with
+ * getline.
+ */
+
+void lexSource(std::string_view text, std::vector<SourceToken> &tokens, std::vector<SourceLine> &lines);
+
+#endif
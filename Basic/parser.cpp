@@ -4,6 +4,9 @@
  * Implements the parser.h interface.
  */
 
+#include <algorithm>
+#include <array>
+#include <vector>
 #include "parser.hpp"
 
 
@@ -13,8 +16,8 @@
  * This code just reads an expression and then checks for extra tokens.
  */
 
-Expression *parseExp(TokenScanner &scanner) {
-    Expression *exp = readE(scanner);
+Expression *parseExp(TokenScanner &scanner, Arena &arena) {
+    Expression *exp = readE(scanner, arena);
     if (scanner.hasMoreTokens()) {
         error("parseExp: Found extra token: " + scanner.nextToken());
     }
@@ -22,61 +25,179 @@ Expression *parseExp(TokenScanner &scanner) {
 }
 
 /*
- * Implementation notes: readE
- * Usage: exp = readE(scanner, prec);
+ * Implementation notes: readE, readT
  * ----------------------------------
- * This version of readE uses precedence to resolve the ambiguity in
- * the grammar.  At each recursive level, the parser reads operators and
- * subexpressions until it finds an operator whose precedence is greater
- * than the prevailing one.  When a higher-precedence operator is found,
- * readE calls itself recursively to read in that subexpression as a unit.
+ * Both functions are driven by parseLoop, which is the recursive
+ * precedence parser turned inside out: each call that the recursive
+ * version would make is pushed on an explicit stack as a Frame, so
+ * parsing itself uses no C++ stack however deep the expression.  There
+ * are three kinds of frame:
+ *
+ *   LEVEL    -- a readE call that reads operators whose precedence is
+ *               greater than prec.  Once its first term has been read,
+ *               lhs holds the expression so far, depth its depth, and
+ *               op the operator whose right operand is being read
+ *               above it.
+ *   NEGATION -- a unary minus, waiting for the readE(0) that follows it.
+ *   PAREN    -- an open parenthesis, waiting for the readE(0) inside it.
+ *
+ * The tokens are consumed and peeked at in exactly the same order as
+ * in the recursive version, so the shape of the trees, the token left
+ * for the caller and the errors are all unchanged.  In particular, a
+ * unary minus still takes the whole rest of the expression at its level
+ * as its operand, so -a + b is -(a + b).  The negation is a NegateExp,
+ * except that a literal is negated on the spot, so -5 is a single
+ * ConstantExp.
+ *
+ * Evaluation and the compilers still recurse once per level of the
+ * tree, so the loop tracks the depth of every node it builds and
+ * rejects an expression deeper than MAX_EXP_NESTING.  Parentheses on
+ * their own add no depth.
+ *
+ * The stack is shared by every call, and keeps its storage from one
+ * expression to the next.  Each call only uses the frames above the
+ * ones it found, and removes them again on the way out, even when an
+ * error is thrown.
  */
 
-Expression *readE(TokenScanner &scanner, int prec) {
-    Expression *exp = readT(scanner);
-    std::string token;
+enum FrameKind { LEVEL, NEGATION, PAREN };
+
+struct Frame {
+    FrameKind kind;
+    int prec;
+    Operator op;
+    Expression *lhs;
+    int depth;
+};
+
+static std::vector<Frame> frames;
+
+static Expression *negate(Expression *exp, Arena &arena) {
+    if (exp->getType() == CONSTANT) {
+        return new (arena) ConstantExp(int(0u - unsigned(((ConstantExp *) exp)->getValue())));
+    }
+    return new (arena) NegateExp(exp);
+}
+
+class FrameGuard {
+public:
+    FrameGuard() : base(frames.size()) {}
+    ~FrameGuard() { frames.resize(base); }
+    size_t base;
+};
+
+static Expression *parseLoop(TokenScanner &scanner, Arena &arena, int prec, bool termOnly) {
+    FrameGuard guard;
+    if (!termOnly) frames.push_back({LEVEL, prec, ASSIGN_OP, nullptr, 0});
+    Expression *exp;
+    int depth;
     while (true) {
-        token = scanner.nextToken();
-        int newPrec = precedence(token);
-        if (newPrec <= prec) break;
-        Expression *rhs = readE(scanner, newPrec);
-        exp = new CompoundExp(token, exp, rhs);
+
+        /* Reads a term, opening frames until one is complete */
+        std::string_view token = scanner.nextTokenView();
+        TokenType type = scanner.getTokenType(token);
+        if (type == WORD) {
+            exp = new (arena) IdentifierExp(std::string(token));
+        } else if (type == NUMBER) {
+            exp = new (arena) ConstantExp(parseIntegerLiteral(token));
+        } else {
+            if (token == "-") {
+                frames.push_back({NEGATION, 0, SUB_OP, nullptr, 0});
+            } else if (token == "(") {
+                frames.push_back({PAREN, 0, ASSIGN_OP, nullptr, 0});
+            } else {
+                error("Illegal term in expression");
+            }
+            frames.push_back({LEVEL, 0, ASSIGN_OP, nullptr, 0});
+            continue;
+        }
+        depth = 1;
+
+        /* Hands exp up until some level reads another operand */
+        while (true) {
+            if (frames.size() == guard.base) return exp;
+            Frame &top = frames.back();
+            if (top.kind != LEVEL) {
+                if (top.kind == NEGATION) {
+                    exp = negate(exp, arena);
+                    depth = (exp->getType() == CONSTANT) ? 1 : depth + 1;
+                } else if (scanner.nextTokenView() != ")") {
+                    error("Unbalanced parentheses in expression");
+                }
+                frames.pop_back();
+                continue;
+            }
+            if (top.lhs == nullptr) {
+                top.lhs = exp;
+                top.depth = depth;
+            } else {
+                top.lhs = newCompoundExp(top.op, top.lhs, exp, arena);
+                top.depth = std::max(top.depth, depth) + 1;
+            }
+            if (top.depth > MAX_EXP_NESTING) error("Expression nested too deeply");
+            int newPrec = precedence(scanner.peekToken(), top.op);
+            if (newPrec > top.prec) {
+                scanner.nextTokenView();
+                frames.push_back({LEVEL, newPrec, ASSIGN_OP, nullptr, 0});
+                break;
+            }
+            exp = top.lhs;
+            depth = top.depth;
+            frames.pop_back();
+        }
     }
-    scanner.saveToken(token);
-    return exp;
 }
 
-/*
- * Implementation notes: readT
- * ---------------------------
- * This function scans a term, which is either an integer, an identifier,
- * or a parenthesized subexpression.
- */
+Expression *readE(TokenScanner &scanner, Arena &arena, int prec) {
+    return parseLoop(scanner, arena, prec, false);
+}
+
+Expression *readT(TokenScanner &scanner, Arena &arena) {
+    return parseLoop(scanner, arena, 0, true);
+}
 
-Expression *readT(TokenScanner &scanner) {
-    std::string token = scanner.nextToken();
-    TokenType type = scanner.getTokenType(token);
-    if (type == WORD) return new IdentifierExp(token);
-    if (type == NUMBER) return new ConstantExp(stringToInteger(token));
-    if (token == "-") return new CompoundExp(token, new ConstantExp(0), readE(scanner));
-    if (token != "(") error("Illegal term in expression");
-    Expression *exp = readE(scanner);
-    if (scanner.nextToken() != ")") {
-        error("Unbalanced parentheses in expression");
+int parseIntegerLiteral(std::string_view token) {
+    int value = 0;
+    switch (parseInteger(token, value)) {
+        case INTEGER_OK:
+            break;
+        case INTEGER_INVALID:
+            error("SYNTAX ERROR");
+            break;
+        case INTEGER_OUT_OF_RANGE:
+            throw NumberRangeException();
     }
-    return exp;
+    return value;
 }
 
 /*
  * Implementation notes: precedence
  * --------------------------------
- * This function checks the token against each of the defined operators
- * and returns the appropriate precedence value.
+ * Every operator is a single character, so the token is looked up in a
+ * table indexed by that character, which holds 0 for any character that
+ * is not an operator.
  */
 
-int precedence(std::string token) {
-    if (token == "=") return 1;
-    if (token == "+" || token == "-") return 2;
-    if (token == "*" || token == "/") return 3;
-    return 0;
+struct OperatorEntry {
+    int prec;
+    Operator op;
+};
+
+static constexpr std::array<OperatorEntry, 256> makeOperatorTable() {
+    std::array<OperatorEntry, 256> table = {};
+    table['='] = {1, ASSIGN_OP};
+    table['+'] = {2, ADD_OP};
+    table['-'] = {2, SUB_OP};
+    table['*'] = {3, MUL_OP};
+    table['/'] = {3, DIV_OP};
+    return table;
+}
+
+static constexpr std::array<OperatorEntry, 256> OPERATOR_TABLE = makeOperatorTable();
+
+int precedence(std::string_view token, Operator &op) {
+    if (token.length() != 1) return 0;
+    const OperatorEntry &entry = OPERATOR_TABLE[(unsigned char) token[0]];
+    if (entry.prec != 0) op = entry.op;
+    return entry.prec;
 }
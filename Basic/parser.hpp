@@ -16,50 +16,90 @@
 #include "Utils/strlib.hpp"
 
 
+/*
+ * Constant: MAX_EXP_NESTING
+ * -------------------------
+ * The greatest depth of expression tree that the parser accepts,
+ * counting each operator and unary minus as one level.  Evaluation and
+ * the compilers recurse once per level, so a deeper expression is
+ * rejected when it is parsed instead of overflowing the C++ stack when
+ * it runs.
+ */
+
+const int MAX_EXP_NESTING = 10000;
+
 /*
  * Function: parseExp
- * Usage: Expression *exp = parseExp(scanner);
- * -------------------------------------------
+ * Usage: Expression *exp = parseExp(scanner, arena);
+ * --------------------------------------------------
  * Parses an expression by reading tokens from the scanner, which must
  * be provided by the client.  The scanner should be set to ignore
- * whitespace and to scan numbers.
+ * whitespace and to scan numbers.  The nodes of the expression are
+ * allocated in arena, and remain valid until it is cleared.  An
+ * expression nested more than MAX_EXP_NESTING deep is an error.
  * 通过从扫描程序读取令牌来分析表达式，扫描程序必须由客户端提供。扫描仪应设置为忽略空白并扫描数字。
  */
 
-Expression *parseExp(TokenScanner &scanner);
+Expression *parseExp(TokenScanner &scanner, Arena &arena);
 
 /*
  * Function: readE
- * Usage: Expression *exp = readE(scanner, prec);
- * ----------------------------------------------
+ * Usage: Expression *exp = readE(scanner, arena, prec);
+ * -----------------------------------------------------
  * Returns the next expression from the scanner involving only operators
  * whose precedence is at least prec.  The prec argument is optional and
  * defaults to 0, which means that the function reads the entire expression.
  * 从仅涉及优先级至少为prec的运算符的扫描程序返回下一个表达式。prec参数是可选的，默认为0，这意味着函数读取整个表达式。
  */
 
-Expression *readE(TokenScanner &scanner, int prec = 0);
+Expression *readE(TokenScanner &scanner, Arena &arena, int prec = 0);
 
 /*
  * Function: readT
- * Usage: Expression *exp = readT(scanner);
- * ----------------------------------------
+ * Usage: Expression *exp = readT(scanner, arena);
+ * -----------------------------------------------
  * Returns the next individual term, which is either a constant, an
  * identifier, or a parenthesized subexpression.
  * 返回下一个单独的项，该项是常量、标识符或带括号的子表达式。
  */
 
-Expression *readT(TokenScanner &scanner);
+Expression *readT(TokenScanner &scanner, Arena &arena);
+
+/*
+ * Class: NumberRangeException
+ * ---------------------------
+ * The ErrorException raised for an integer literal too large for an
+ * int.  Its message is INVALID NUMBER, the one INPUT prints for the
+ * same reply.  parseStatement passes it on by type instead of turning
+ * it into SYNTAX ERROR like every other parse error.
+ */
+
+class NumberRangeException : public ErrorException {
+public:
+    NumberRangeException() : ErrorException("INVALID NUMBER") {}
+};
+
+/*
+ * Function: parseIntegerLiteral
+ * Usage: int value = parseIntegerLiteral(token);
+ * ----------------------------------------------
+ * Returns the value of a NUMBER token.  A token that is not an integer
+ * raises SYNTAX ERROR, and one too large for an int raises a
+ * NumberRangeException.
+ */
+
+int parseIntegerLiteral(std::string_view token);
 
 /*
  * Function: precedence
- * Usage: int prec = precedence(token);
- * ------------------------------------
- * Returns the precedence of the specified operator token.  If the token
- * is not an operator, precedence returns 0.
+ * Usage: int prec = precedence(token, op);
+ * ----------------------------------------
+ * Returns the precedence of the specified operator token and stores the
+ * matching Operator in op.  If the token is not an operator, precedence
+ * returns 0 and leaves op unchanged.
  * 返回指定运算符标记的优先级。如果令牌不是运算符，则优先级返回0。
  */
 
-int precedence(std::string token);
+int precedence(std::string_view token, Operator &op);
 
 #endif
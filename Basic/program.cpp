@@ -10,202 +10,463 @@
  * 您的工作是用满足作业中指定的性能保证的实现来填充这些方法中的每一个方法的主体。
  */
 
+#include <algorithm>
+#include <climits>
 #include "program.hpp"
+#include "cfg.hpp"
 
 
 
 Program::Program() = default;
 
-Program::~Program() = default;
+Program::~Program() {
+    clear();
+}
 
 void Program::clear() {
-    lines.clear();
+    slots.clear();
+    freeSlots.clear();
+    index.clear();
+    first = last = cursor = -1;
+    text.clear();
+    garbage = 0;
+    jumps.clear();
+    nodes.clear();
+    staleTrees = 0;
+    graph.reset();
 }
 
+/*
+ * Implementation notes: addSourceLine
+ * -----------------------------------
+ * The line is parsed before anything is stored, so a line with a
+ * syntax error leaves the program unchanged and the error propagates
+ * to the caller.
+ *
+ * A new line costs a binary search of the index and a move of the
+ * entries after it in its chunk.  A line numbered above every other
+ * one, which is every line of a program loaded in order, is simply
+ * appended to the last chunk without any search.
+ */
+
 void Program::addSourceLine(int lineNumber, const std::string &line) {
-    lines[lineNumber]=line;
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    scanner.setInputView(line);
+    scanner.nextTokenView();
+    addSourceLine(lineNumber, line, scanner);
+}
+
+void Program::addSourceLine(int lineNumber, std::string_view line, TokenScanner &scanner) {
+    Statement *stmt;
+    try {
+        stmt = parseStatement(scanner, nodes);
+    } catch (ErrorException &ex) {
+        staleTrees++;
+        throw;
+    }
+    dropGraph();
+    bool append = last == -1 || slots[last].number < lineNumber;
+    int slot = append ? -1 : find(lineNumber);
+    if (slot == -1) slot = insertEntry(lineNumber);
+    Line &entry = slots[slot];
+    setSource(entry, line);
+    setParsedStatement(lineNumber, stmt);
 }
 
 void Program::removeSourceLine(int lineNumber) {
-    if (lines.find(lineNumber)!=lines.end()) lines.erase(lineNumber);
+    int slot = find(lineNumber);
+    if (slot == -1) return;
+    dropGraph();
+    unlinkLine(slot);
+    eraseEntry(lineNumber);
+    cursor = -1;
+    Line &line = slots[slot];
+    garbage += line.sourceLength;
+    line = Line();
+    freeSlots.push_back(slot);
+    staleTrees++;
+    if (staleTrees > int(slots.size() - freeSlots.size())) compactTrees();
 }
 
 std::string Program::getSourceLine(int lineNumber) {
-    if (lines.find(lineNumber)==lines.end()) return "";
-    else return lines[lineNumber];
+    int slot = find(lineNumber);
+    if (slot == -1) return "";
+    Line &line = slots[slot];
+    return text.substr(line.sourceOffset, line.sourceLength);
 }
 
 void Program::setParsedStatement(int lineNumber, Statement *stmt) {
-    // Replace this stub with your own code
-    //todo
+    int slot = find(lineNumber);
+    if (slot == -1) error("LINE NUMBER ERROR");
+    dropGraph();
+    unlinkTarget(slot);
+    if (slots[slot].stmt != nullptr) staleTrees++;
+    slots[slot].stmt = stmt;
+    slots[slot].hits = 0;
+    linkTarget(slot);
+    if (staleTrees > int(slots.size() - freeSlots.size())) compactTrees();
 }
 
-//void Program::removeSourceLine(int lineNumber) {
+Arena &Program::getArena() {
+    return nodes;
+}
 
 Statement *Program::getParsedStatement(int lineNumber) {
-   // Replace this stub with your own code
-   //todo
+    int slot = find(lineNumber);
+    if (slot == -1) return nullptr;
+    return slots[slot].stmt;
 }
 
 int Program::getFirstLineNumber() {
-    if(!lines.empty()) return lines.begin()->first;
+    if (first != -1) return slots[first].number;
     return -1;
 }
 
+/*
+ * Implementation notes: getNextLineNumber
+ * ---------------------------------------
+ * The back ends walk the program with getFirstLineNumber and
+ * getNextLineNumber, so the slot of the last line returned is
+ * remembered, and the line after it is found without a search.
+ */
+
 int Program::getNextLineNumber(int lineNumber) {
-    auto it = lines.find(lineNumber);
-    if (it != lines.end()){
-        it++;
-        if (it!=lines.end()) return it->first;
-        return -1;
+    int slot = (cursor != -1 && slots[cursor].number == lineNumber) ? cursor : find(lineNumber);
+    if (slot != -1) {
+        slot = slots[slot].next;
+    } else {
+        size_t chunk, pos;
+        locate(lineNumber, chunk, pos);
+        if (chunk < index.size()) slot = index[chunk][pos].slot;
     }
+    cursor = slot;
+    return (slot == -1) ? -1 : slots[slot].number;
 }
 
 //more func to add
-void Program::PrintLines(){
-    for (auto & line : lines){
-        std::cout << line.second <<'\n';
+void Program::PrintLines() {
+    for (const std::vector<Entry> &chunk : index) {
+        for (const Entry &entry : chunk) {
+            const Line &line = slots[entry.slot];
+            std::cout.write(text.data() + line.sourceOffset, line.sourceLength) << '\n';
+        }
     }
 }
 
-bool cmp(int l, int r, std::string op){
-    if (op=="<") return l<r;
-    if (op=="=") return l==r;
-    if (op==">") return l>r;
-    return true;
-}
+/*
+ * Implementation notes: Run, runUntilHot
+ * --------------------------------------
+ * The interpreter runs the program a basic block at a time.  Before
+ * executing a block, the loop sets nextLine to the line after it.
+ * GOTO, IF and END can only come last in a block, and overwrite it
+ * through jumpTo and halt.  The line to continue at is then almost
+ * always the start of the block's next or target block, so the graph
+ * is only searched for a jump that came from somewhere else.  A target
+ * that does not exist is only reported once the jump is taken.  Run is
+ * simply a run that never becomes hot.
+ *
+ * GOSUB pushes the index of the block after its own, which begins
+ * with the line to return to, and RETURN hands the index it pops to
+ * the loop through resume, so neither needs a search.
+ */
 
 void Program::Run(Program &program, EvalState &state) {
-    int pointer = getFirstLineNumber();
-    while(pointer!=-1){
-        std::string line = getSourceLine(pointer);
-        if (line.empty()) {
-            std::cout<<"LINE NUMBER ERROR\n";
-            return;
-        }
-        TokenScanner scanner;
-        scanner.ignoreWhitespace();
-        scanner.scanNumbers();
-        scanner.setInput(line);
-        std::string m=scanner.nextToken();
-        m = scanner.nextToken();
-        if (m == "REM") ;
-        else if (m == "LET") {
-            std::string var=scanner.nextToken();
-            if (var == "LET") {
-                std::cout<<"SYNTAX ERROR\n";
-                return;
-            }
-            scanner.nextToken();
-            auto w = readE(scanner);
-            try{
-                state.setValue(var,w->eval(state));
-                delete w;
-            }
-            catch (ErrorException &ex) {
-                delete w;
-                std::cout << ex.getMessage() << std::endl;
-            }
-        }
-        else if (m == "PRINT") {
-            auto w = readE(scanner);
-            try{
-                std::cout << w->eval(state) << '\n';
-                delete w;
-            }
-            catch (ErrorException &ex) {
-                delete w;
-                std::cout << ex.getMessage() << std::endl;
-            }
-        }
-        else if (m == "INPUT") {
-            std::string var=scanner.nextToken();
-            while(true){
-                std::cout << " ? ";
-                std::string num;
-                getline(std::cin,num);
-                bool flag2= true;
-                if (!(isdigit(num[0])||num[0]=='-')){
-                    std::cout << "INVALID NUMBER\n";
-                    continue;
-                }
-                for (int i = 1; i<num.length();i++) {
-                    if (!isdigit(num[i])){
-                        flag2=false;
-                        break;
-                    }
-                }
-                if (!flag2) {
-                    std::cout << "INVALID NUMBER\n";
-                    continue;
-                }
-                int num2=std::stoi(num);
-                state.setValue(var,num2);
-                break;
-            }
-        }
-        else if (m == "END") { return; }
-        else if (m == "GOTO") {
-            pointer = std::stoi(scanner.nextToken());
-            continue;
+    runUntilHot(state, LLONG_MAX);
+}
+
+int Program::runUntilHot(EvalState &state, long long threshold) {
+    std::vector<BasicBlock> &blocks = getControlFlowGraph().getBlocks();
+    returns.clear();
+    resume = -1;
+    int b = blocks.empty() ? -1 : 0;
+    while (b != -1) {
+        BasicBlock &block = blocks[b];
+        if (block.hits >= threshold) return block.lines.front();
+        block.hits++;
+        current = b;
+        nextLine = block.nextLine;
+        for (Statement *stmt : block.statements) stmt->execute(state, *this);
+        if (nextLine == -1) break;
+        if (resume != -1) {
+            b = resume;
+            resume = -1;
+        } else if (nextLine == block.nextLine && block.next != -1) {
+            b = block.next;
+        } else if (nextLine == block.targetLine && block.target != -1) {
+            b = block.target;
+        } else {
+            b = graph->findBlock(nextLine);
         }
-        else if (m == "IF"){
-            int l, r;
-            auto L = readE(scanner);
-            CompoundExp* LL = dynamic_cast<CompoundExp*>(L);
-            Expression* R;
-            std::string op;
-            if (LL!= nullptr && LL->getOp()=="="){
-                L=LL->getLHS();
-                op="=";
-                R=LL->getRHS();
-                try{
-                    l= L->eval(state);
-                }
-                catch (ErrorException &ex) {
-                    std::cout << ex.getMessage() << std::endl;
-                }
-                try{
-                    r= R->eval(state);
-                }
-                catch (ErrorException &ex) {
-                    std::cout << ex.getMessage() << std::endl;
-                }
-                delete LL;
-            }
-            else {
-                op = scanner.nextToken();
-                R = readE(scanner);
-                try{
-                    l= L->eval(state);
-                    delete L;
-                }
-                catch (ErrorException &ex) {
-                    delete L;
-                    std::cout << ex.getMessage() << std::endl;
-                }
-                try{
-                    r= R->eval(state);
-                    delete R;
-                }
-                catch (ErrorException &ex) {
-                    delete R;
-                    std::cout << ex.getMessage() << std::endl;
-                }
-            }
-
-            if(cmp(l,r,op)){
-                scanner.nextToken();
-                pointer = std::stoi(scanner.nextToken());
-                continue;
-            }
+        if (b == -1) {
+            std::cout << "LINE NUMBER ERROR\n";
+            break;
         }
-        else {
-            error("SYNTAX ERROR");
+    }
+    return -1;
+}
+
+/*
+ * Implementation notes: dropGraph
+ * -------------------------------
+ * Each line keeps the count of its runs up to the time the current
+ * graph was built, and each block counts from the count of its first
+ * line, which is what runUntilHot compares with its threshold.  Every
+ * line of a block runs as often as the block, unless an error stops it
+ * part way, so the runs since the graph was built are taken to be the
+ * same for all of them.  dropGraph must be called before an edit
+ * changes the chain of lines, since it walks that chain to add those
+ * runs back to each line.
+ */
+
+void Program::dropGraph() {
+    if (!graph) return;
+    for (BasicBlock &block : graph->getBlocks()) {
+        long long runs = block.hits - block.startHits;
+        if (runs == 0) continue;
+        int slot = find(block.lines.front());
+        for (size_t i = 0; i < block.lines.size(); i++, slot = slots[slot].next) {
+            slots[slot].hits += runs;
         }
-        pointer = getNextLineNumber(pointer);
     }
+    graph.reset();
 }
 
+void Program::jumpTo(int lineNumber) {
+    nextLine = lineNumber;
+}
+
+void Program::halt() {
+    nextLine = -1;
+}
+
+void Program::callSubroutine(int lineNumber) {
+    BasicBlock &block = graph->getBlocks()[current];
+    returns.push(block.nextLine == -1 ? -1 : block.next);
+    nextLine = lineNumber;
+}
 
+void Program::returnFromSubroutine() {
+    int b = returns.pop();
+    if (b == -1) {
+        nextLine = -1;
+    } else {
+        nextLine = graph->getBlocks()[b].lines.front();
+        resume = b;
+    }
+}
+
+std::vector<int> Program::getReturnLines() {
+    std::vector<BasicBlock> &blocks = graph->getBlocks();
+    std::vector<int> lines;
+    for (int i = 0; i < returns.size(); i++) {
+        int b = returns.get(i);
+        lines.push_back(b == -1 ? -1 : blocks[b].lines.front());
+    }
+    return lines;
+}
+
+ControlFlowGraph &Program::getControlFlowGraph() {
+    if (!graph) graph.reset(new ControlFlowGraph(*this));
+    return *graph;
+}
+
+/*
+ * Implementation notes: the line index
+ * ------------------------------------
+ * locate finds the position of the first entry whose number is not
+ * less than lineNumber: a binary search over the last number of each
+ * chunk picks the chunk, and a second one the entry within it.  If
+ * there is no such entry, chunk is index.size().
+ *
+ * insertEntry gives the line a slot and an entry.  A chunk that grows
+ * past MAX_CHUNK entries is split in two, so inserting anywhere moves
+ * at most MAX_CHUNK entries and one chunk header per chunk.  Lines
+ * appended in order fill each chunk before starting the next one.
+ */
 
+void Program::locate(int lineNumber, size_t &chunk, size_t &pos) {
+    auto c = std::lower_bound(index.begin(), index.end(), lineNumber,
+                              [](const std::vector<Entry> &entries, int number) {
+                                  return entries.back().number < number;
+                              });
+    chunk = c - index.begin();
+    pos = 0;
+    if (chunk == index.size()) return;
+    auto e = std::lower_bound(c->begin(), c->end(), lineNumber,
+                              [](const Entry &entry, int number) { return entry.number < number; });
+    pos = e - c->begin();
+}
+
+int Program::find(int lineNumber) {
+    size_t chunk, pos;
+    locate(lineNumber, chunk, pos);
+    if (chunk == index.size() || index[chunk][pos].number != lineNumber) return -1;
+    return index[chunk][pos].slot;
+}
+
+int Program::insertEntry(int lineNumber) {
+    int slot;
+    if (freeSlots.empty()) {
+        slot = int(slots.size());
+        slots.emplace_back();
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    slots[slot].number = lineNumber;
+    size_t chunk = index.size(), pos = 0;
+    if (last != -1 && slots[last].number > lineNumber) locate(lineNumber, chunk, pos);
+    int successor = (chunk == index.size()) ? -1 : index[chunk][pos].slot;
+    if (chunk == index.size()) {
+        if (index.empty() || index.back().size() >= MAX_CHUNK) index.emplace_back();
+        chunk = index.size() - 1;
+        pos = index[chunk].size();
+    }
+    std::vector<Entry> &entries = index[chunk];
+    entries.insert(entries.begin() + pos, {lineNumber, slot});
+    if (entries.size() > MAX_CHUNK) {
+        std::vector<Entry> upper(entries.begin() + entries.size() / 2, entries.end());
+        entries.resize(entries.size() / 2);
+        index.insert(index.begin() + chunk + 1, std::move(upper));
+    }
+    linkLine(slot, successor);
+    return slot;
+}
+
+void Program::eraseEntry(int lineNumber) {
+    size_t chunk, pos;
+    locate(lineNumber, chunk, pos);
+    index[chunk].erase(index[chunk].begin() + pos);
+    if (index[chunk].empty()) index.erase(index.begin() + chunk);
+}
+
+/*
+ * Implementation notes: setSource, compactText
+ * --------------------------------------------
+ * The source of a line is appended to text, and the space taken by the
+ * text it replaces becomes garbage.  Once garbage makes up more than
+ * half of text, compactText copies the live sources into a new buffer
+ * in line order, so the cost of compacting is spread over the edits
+ * that made it necessary, and LIST reads text from front to back.
+ */
+
+void Program::setSource(Line &line, std::string_view source) {
+    garbage += line.sourceLength;
+    line.sourceOffset = text.size();
+    line.sourceLength = int(source.length());
+    text.append(source);
+    if (garbage > text.size() / 2) compactText();
+}
+
+void Program::compactText() {
+    std::string compacted;
+    compacted.reserve(text.size() - garbage);
+    for (int slot = first; slot != -1; slot = slots[slot].next) {
+        Line &line = slots[slot];
+        size_t offset = compacted.size();
+        compacted.append(text, line.sourceOffset, line.sourceLength);
+        line.sourceOffset = offset;
+    }
+    text.swap(compacted);
+    garbage = 0;
+}
+
+/*
+ * Implementation notes: compactTrees
+ * ----------------------------------
+ * Statements are allocated from one arena, so replacing a line cannot
+ * free its old tree.  Once the stale trees outnumber the live lines,
+ * compactTrees parses the source of every line again into a fresh
+ * arena and drops the old one whole.  Each pass is linear in the size
+ * of the program, but it needs as many replacements as there are live
+ * lines, so every replacement costs amortized constant time, as with
+ * compactText.  The trees are rebuilt from source: a statement handed
+ * to setParsedStatement is replaced by the parser's version of its line.
+ * The line numbers do not change, so the links between lines stay valid.
+ */
+
+void Program::compactTrees() {
+    Arena fresh;
+    TokenScanner scanner;
+    scanner.ignoreWhitespace();
+    scanner.scanNumbers();
+    for (int slot = first; slot != -1; slot = slots[slot].next) {
+        Line &line = slots[slot];
+        scanner.setInputView(std::string_view(text).substr(line.sourceOffset, line.sourceLength));
+        scanner.nextTokenView();
+        line.stmt = parseStatement(scanner, fresh);
+    }
+    nodes = std::move(fresh);
+    staleTrees = 0;
+}
+
+/*
+ * Implementation notes: linkLine, unlinkLine, linkTarget, unlinkTarget
+ * --------------------------------------------------------------------
+ * linkLine splices a new line into the chain of next and prev links in
+ * front of its successor, or at the end if it has none, and points
+ * every line that jumps to its number at it; unlinkLine undoes both.
+ * linkTarget and unlinkTarget keep the target of one line in step with
+ * its statement.  No other line is touched by an edit.  Links are slot
+ * numbers rather than pointers, since slots moves when it grows.
+ */
+
+static int jumpTarget(Statement *stmt) {
+    switch (stmt->getType()) {
+        case GOTO_STMT: return ((GotoStmt *) stmt)->getLineNumber();
+        case IF_STMT: return ((IfStmt *) stmt)->getLineNumber();
+        case GOSUB_STMT: return ((GosubStmt *) stmt)->getLineNumber();
+        default: return -1;
+    }
+}
+
+void Program::linkLine(int slot, int successor) {
+    Line &line = slots[slot];
+    int predecessor = (successor == -1) ? last : slots[successor].prev;
+    line.next = successor;
+    line.prev = predecessor;
+    if (predecessor == -1) first = slot;
+    else slots[predecessor].next = slot;
+    if (successor == -1) last = slot;
+    else slots[successor].prev = slot;
+    auto range = jumps.equal_range(line.number);
+    for (auto jump = range.first; jump != range.second; ++jump) {
+        slots[jump->second].target = slot;
+    }
+}
+
+void Program::unlinkLine(int slot) {
+    Line &line = slots[slot];
+    unlinkTarget(slot);
+    if (line.prev == -1) first = line.next;
+    else slots[line.prev].next = line.next;
+    if (line.next == -1) last = line.prev;
+    else slots[line.next].prev = line.prev;
+    auto range = jumps.equal_range(line.number);
+    for (auto jump = range.first; jump != range.second; ++jump) {
+        slots[jump->second].target = -1;
+    }
+}
+
+void Program::linkTarget(int slot) {
+    Line &line = slots[slot];
+    line.targetNumber = jumpTarget(line.stmt);
+    if (line.targetNumber == -1) return;
+    jumps.emplace(line.targetNumber, slot);
+    line.target = find(line.targetNumber);
+}
+
+void Program::unlinkTarget(int slot) {
+    Line &line = slots[slot];
+    auto range = jumps.equal_range(line.targetNumber);
+    for (auto jump = range.first; jump != range.second; ++jump) {
+        if (jump->second == slot) {
+            jumps.erase(jump);
+            break;
+        }
+    }
+    line.targetNumber = -1;
+    line.target = -1;
+}
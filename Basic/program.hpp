@@ -8,14 +8,18 @@
 #ifndef _program_h
 #define _program_h
 
+#include <memory>
 #include <string>
 #include <vector>
-#include <set>
+#include <string_view>
 #include <unordered_map>
+#include "evalstate.hpp"
+#include "returnstack.hpp"
 #include "statement.hpp"
 
 
 class Statement;
+class ControlFlowGraph;
 
 /*
  * This class stores the lines in a BASIC program.  Each line
@@ -80,6 +84,17 @@ public:
 
     void addSourceLine(int lineNumber, const std::string& line);
 
+/*
+ * Method: addSourceLine
+ * Usage: program.addSourceLine(lineNumber, line, scanner);
+ * --------------------------------------------------------
+ * Like the two-argument form, but parses the statement from a scanner
+ * that the caller has already set to line and advanced past the line
+ * number.  This lets a loader supply tokens it has found in advance.
+ */
+
+    void addSourceLine(int lineNumber, std::string_view line, TokenScanner &scanner);
+
 /*
  * Method: removeSourceLine
  * Usage: program.removeSourceLine(lineNumber);
@@ -110,15 +125,26 @@ public:
  * Usage: program.setParsedStatement(lineNumber, stmt);
  * ----------------------------------------------------
  * Adds the parsed representation of the statement to the statement
- * at the specified line number.  If no such line exists, this
- * method raises an error.  If a previous parsed representation
- * exists, the memory for that statement is reclaimed.
- * 将已解析的语句表示形式添加到指定行号的语句中。如果不存在这样的行，则此方法
- * 会引发错误。如果存在先前解析的表示，则回收该语句的内存。
+ * at the specified line number.  Its nodes must have been allocated
+ * from getArena.  If no such line exists, this method raises an error.
+ * A previous parsed representation is left in the arena until the
+ * program next reclaims the space of replaced statements.  That
+ * reclamation parses every line again from its source text, so a
+ * statement passed here is only kept until then if it matches what
+ * the parser makes of the line.
  */
 
     void setParsedStatement(int lineNumber, Statement *stmt);
 
+/*
+ * Method: getArena
+ * Usage: Statement *stmt = parseStatement(scanner, program.getArena());
+ * ---------------------------------------------------------------------
+ * Returns the arena that holds the statements of every line.
+ */
+
+    Arena &getArena();
+
 /*
  * Method: getParsedStatement
  * Usage: Statement *stmt = program.getParsedStatement(lineNumber);
@@ -160,12 +186,179 @@ public:
 
     //void Run();
 
+/*
+ * Method: Run
+ * Usage: program.Run(program, state);
+ * -----------------------------------
+ * Executes the program from its first line, using the statements
+ * that were parsed when each line was added.  Errors raised by a
+ * statement stop the program and propagate to the caller.  A jump to
+ * a line that does not exist prints LINE NUMBER ERROR.
+ */
+
     void Run(Program &program, EvalState &state);
 
+/*
+ * Method: runUntilHot
+ * Usage: int line = program.runUntilHot(state, threshold);
+ * --------------------------------------------------------
+ * Runs the program the same way as Run, counting every execution of
+ * each line.  If a line is about to run after it has already run
+ * threshold times, the run pauses before that line and returns its
+ * number, so that a faster back end can carry on from there, taking
+ * over the calls in progress from getReturnLines.  Returns -1 if the
+ * program stops first.
+ */
+
+    int runUntilHot(EvalState &state, long long threshold);
+
+/*
+ * Methods: jumpTo, halt
+ * Usage: program.jumpTo(lineNumber);
+ *        program.halt();
+ * ----------------------------------
+ * These methods are called by executing statements to change which
+ * line Run executes next.  jumpTo continues at the given line and
+ * halt stops the program after the current statement.
+ */
+
+    void jumpTo(int lineNumber);
+
+    void halt();
+
+/*
+ * Methods: callSubroutine, returnFromSubroutine
+ * Usage: program.callSubroutine(lineNumber);
+ *        program.returnFromSubroutine();
+ * -------------------------------------------
+ * These methods are called by GOSUB and RETURN.  callSubroutine jumps
+ * to the given line after pushing the line that follows the current
+ * one, and returnFromSubroutine continues at the most recently pushed
+ * line.  Returning from a GOSUB on the last line stops the program.
+ */
+
+    void callSubroutine(int lineNumber);
+
+    void returnFromSubroutine();
+
+/*
+ * Method: getReturnLines
+ * Usage: std::vector<int> lines = program.getReturnLines();
+ * ---------------------------------------------------------
+ * Returns the lines that the GOSUB calls in progress will return to,
+ * innermost last, with -1 for a return that stops the program.  It is
+ * meant to be called after runUntilHot has paused a run.
+ */
+
+    std::vector<int> getReturnLines();
+
+/*
+ * Method: getControlFlowGraph
+ * Usage: ControlFlowGraph &graph = program.getControlFlowGraph();
+ * ---------------------------------------------------------------
+ * Returns the graph of the basic blocks of the program, which lists
+ * the lines that can be reached in order.  The graph is built the
+ * first time it is asked for after an edit and kept until the next
+ * edit, so the reference stays valid only while the program is
+ * unchanged.
+ */
+
+    ControlFlowGraph &getControlFlowGraph();
+
 private:
 
-    // Fill this in with whatever types and instance variables you need
-    std::map<int, std::string> lines;
+    friend class ControlFlowGraph;
+
+/*
+ * Private type: Line
+ * ------------------
+ * The two components stored for each line, its source text and the
+ * parsed statement.  The source is a span of text, the buffer that
+ * holds the source of every line, and every node of the statement
+ * lives in nodes, the arena shared by all lines.  The tree of a line
+ * that is replaced or removed stays in the arena as a stale tree until
+ * compactTrees, and clear releases every tree at once.
+ *
+ * Each line is also linked to the line that follows it and, for GOTO
+ * and IF, to the line it jumps to, so the control flow graph can be
+ * built without searching.  jumps indexes the lines by the number they
+ * jump to, which lets an edit relink just the lines that refer to it.
+ *
+ * While a graph exists, the interpreter counts runs in its blocks.
+ * dropGraph adds those counts back to the lines of each block before
+ * an edit discards the graph.
+ */
+
+    struct Line {
+        Statement *stmt = nullptr;
+        size_t sourceOffset = 0;
+        int sourceLength = 0;
+        int number = -1;
+        int targetNumber = -1;     /* The line a GOTO or IF jumps to   */
+        int next = -1;             /* Slot of the line that follows    */
+        int prev = -1;             /* Slot of the line that precedes   */
+        int target = -1;           /* Slot of the line at targetNumber */
+        long long hits = 0;        /* Runs in the interpreter          */
+    };
+
+/*
+ * Private type: Entry
+ * -------------------
+ * One entry of the line index, which maps a line number to the slot
+ * that holds the line.  The index is a list of chunks, each a sorted
+ * vector of at most MAX_CHUNK entries, with every number in a chunk
+ * below those of the chunks after it.
+ */
+
+    struct Entry {
+        int number;
+        int slot;
+    };
+
+    static const size_t MAX_CHUNK = 512;
+
+    std::vector<Line> slots;                     /* Lines, in no order       */
+    std::vector<int> freeSlots;                  /* Slots not in use         */
+    std::vector<std::vector<Entry>> index;       /* Slots by line number     */
+    int first = -1;                              /* Slot of the first line   */
+    int last = -1;                               /* Slot of the last line    */
+    int cursor = -1;                             /* Slot last walked to      */
+    std::string text;                            /* Source of every line     */
+    size_t garbage = 0;                          /* Unused bytes of text     */
+    std::unordered_multimap<int, int> jumps;     /* Slots by targetNumber    */
+    Arena nodes;                                 /* Statements of all lines  */
+    int staleTrees = 0;                          /* Statements no line uses  */
+    std::unique_ptr<ControlFlowGraph> graph;     /* Built on demand          */
+    int nextLine = -1;             /* The line Run executes next */
+    int current = -1;              /* The block Run is executing */
+    int resume = -1;               /* The block RETURN goes back to */
+    ReturnStack returns;           /* Blocks to return to, or -1 */
+
+/* Private method prototypes */
+
+    int find(int lineNumber);
+
+    void locate(int lineNumber, size_t &chunk, size_t &pos);
+
+    int insertEntry(int lineNumber);
+
+    void eraseEntry(int lineNumber);
+
+    void setSource(Line &line, std::string_view source);
+
+    void compactText();
+
+    void compactTrees();
+
+    void dropGraph();
+
+    void linkLine(int slot, int successor);
+
+    void unlinkLine(int slot);
+
+    void linkTarget(int slot);
+
+    void unlinkTarget(int slot);
 
 };
 
@@ -0,0 +1,354 @@
+/*
+ * File: regvm.cpp
+ * ---------------
+ * This file implements the RegisterVM class.
+ */
+
+#include <iostream>
+#include "regvm.hpp"
+#include "cfg.hpp"
+
+
+/*
+ * Implementation notes: constructor
+ * ---------------------------------
+ * Compilation takes two passes over the live lines of the program.  The
+ * first assigns a register to every variable and constant, which fixes
+ * where the temporaries start.  The second emits the code, patching
+ * jumps the same way StackVM does once every line has an address.
+ */
+
+RegisterVM::RegisterVM(Program &program) {
+    std::vector<BasicBlock> &blocks = program.getControlFlowGraph().getBlocks();
+    for (BasicBlock &block : blocks) {
+        for (Statement *stmt : block.statements) allocate(stmt);
+    }
+    constants.resize(constantSlots.size());
+    for (auto &entry : constantSlots) constants[entry.second] = entry.first;
+    std::vector<int> jumps;
+    for (BasicBlock &block : blocks) {
+        for (size_t i = 0; i < block.lines.size(); i++) {
+            addresses[block.lines[i]] = int(code.size());
+            compileStatement(block.statements[i], jumps);
+        }
+    }
+    end = int(code.size());
+    emit(REG_HALT);
+    int lineError = int(code.size());
+    emit(REG_LINE_ERROR);
+    for (int jump : jumps) {
+        auto it = addresses.find(code[jump].a);
+        code[jump].a = (it == addresses.end()) ? lineError : it->second;
+    }
+}
+
+int RegisterVM::variable(int id) {
+    if (size_t(id) >= slots.size()) slots.resize(id + 1, -1);
+    if (slots[id] != -1) return slots[id];
+    vars.push_back(id);
+    return slots[id] = int(vars.size()) - 1;
+}
+
+int RegisterVM::constant(int value) {
+    return int(vars.size()) + constantSlots[value];
+}
+
+int RegisterVM::temporary(int index) {
+    if (index + 1 > temps) temps = index + 1;
+    return int(vars.size() + constants.size()) + index;
+}
+
+void RegisterVM::emit(int op, int a, int b, int c) {
+    code.push_back({op, a, b, c});
+}
+
+/*
+ * Implementation notes: allocate
+ * ------------------------------
+ * The first pass.  Variables are numbered before constants, so the
+ * constant registers can only be computed once this pass is over.
+ * Expressions are walked with an explicit stack, left operand first,
+ * so the depth of a line costs no C++ stack.
+ */
+
+void RegisterVM::allocate(Statement *stmt) {
+    switch (stmt->getType()) {
+        case LET_STMT:
+            variable(((LetStmt *) stmt)->getVarId());
+            allocate(((LetStmt *) stmt)->getExp());
+            break;
+        case PRINT_STMT:
+            allocate(((PrintStmt *) stmt)->getExp());
+            break;
+        case INPUT_STMT:
+            variable(((InputStmt *) stmt)->getVarId());
+            break;
+        case IF_STMT:
+            allocate(((IfStmt *) stmt)->getLHS());
+            allocate(((IfStmt *) stmt)->getRHS());
+            break;
+        default:
+            break;
+    }
+}
+
+void RegisterVM::allocate(Expression *exp) {
+    std::vector<Expression *> pending = {exp};
+    while (!pending.empty()) {
+        exp = pending.back();
+        pending.pop_back();
+        switch (exp->getType()) {
+            case CONSTANT:
+                constantSlots.emplace(((ConstantExp *) exp)->getValue(), int(constantSlots.size()));
+                break;
+            case IDENTIFIER:
+                variable(((IdentifierExp *) exp)->getId());
+                break;
+            case NEGATE:
+                pending.push_back(((NegateExp *) exp)->getOperand());
+                break;
+            case COMPOUND:
+                pending.push_back(((CompoundExp *) exp)->getRHS());
+                pending.push_back(((CompoundExp *) exp)->getLHS());
+                break;
+        }
+    }
+}
+
+/*
+ * Implementation notes: compileStatement
+ * --------------------------------------
+ * A LET compiles its expression straight into the variable's register,
+ * so the last instruction of the expression is also the assignment.
+ * LET a = a still needs a REG_MOV, since that is what checks a.
+ */
+
+void RegisterVM::compileStatement(Statement *stmt, std::vector<int> &jumps) {
+    switch (stmt->getType()) {
+        case REM_STMT:
+            break;
+        case LET_STMT: {
+            auto *let = (LetStmt *) stmt;
+            int var = variable(let->getVarId());
+            int result = compileExp(let->getExp(), var, 0);
+            if (result != var || let->getExp()->getType() == IDENTIFIER) emit(REG_MOV, var, result);
+            break;
+        }
+        case PRINT_STMT:
+            emit(REG_PRINT, compileExp(((PrintStmt *) stmt)->getExp(), -1, 0));
+            break;
+        case INPUT_STMT:
+            emit(REG_INPUT, variable(((InputStmt *) stmt)->getVarId()));
+            break;
+        case END_STMT:
+            emit(REG_HALT);
+            break;
+        case GOTO_STMT:
+            jumps.push_back(int(code.size()));
+            emit(REG_JUMP, ((GotoStmt *) stmt)->getLineNumber());
+            break;
+        case GOSUB_STMT:
+            jumps.push_back(int(code.size()));
+            emit(REG_GOSUB, ((GosubStmt *) stmt)->getLineNumber());
+            break;
+        case RETURN_STMT:
+            emit(REG_RETURN);
+            break;
+        case IF_STMT: {
+            auto *ifStmt = (IfStmt *) stmt;
+            int lhs = compileExp(ifStmt->getLHS(), -1, 0);
+            if (lhs < int(vars.size()) && ifStmt->getRHS()->hasEffects()) {
+                emit(REG_MOV, temporary(0), lhs);
+                lhs = temporary(0);
+            }
+            int rhs = compileExp(ifStmt->getRHS(), -1, 1);
+            jumps.push_back(int(code.size()));
+            switch (ifStmt->getComparison()) {
+                case LT_CMP: emit(REG_JLT, ifStmt->getLineNumber(), lhs, rhs); break;
+                case EQ_CMP: emit(REG_JEQ, ifStmt->getLineNumber(), lhs, rhs); break;
+                case GT_CMP: emit(REG_JGT, ifStmt->getLineNumber(), lhs, rhs); break;
+            }
+            break;
+        }
+    }
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * Emits code for exp and returns the register that holds its value.
+ * The result is written to target if that is not -1, and temporaries
+ * from temp upwards are free for intermediate values.  Variables and
+ * constants need no code at all; their register is returned directly.
+ *
+ * Because operands are read when the operator executes, a left operand
+ * that is a variable is copied to a temporary first if the right
+ * operand can assign or raise an error other than VARIABLE NOT DEFINED.
+ * This preserves the left-to-right order of CompoundExp::eval.
+ */
+
+int RegisterVM::compileExp(Expression *exp, int target, int temp) {
+    switch (exp->getType()) {
+        case CONSTANT:
+            return constant(((ConstantExp *) exp)->getValue());
+        case IDENTIFIER:
+            return variable(((IdentifierExp *) exp)->getId());
+        case NEGATE: {
+            int operand = compileExp(((NegateExp *) exp)->getOperand(), -1, temp);
+            if (target == -1) target = temporary(temp);
+            emit(REG_NEG, target, operand);
+            return target;
+        }
+        case COMPOUND:
+            break;
+    }
+    auto *compound = (CompoundExp *) exp;
+    Operator op = compound->getOp();
+    Expression *lhs = compound->getLHS();
+    if (op == ASSIGN_OP) {
+        if (lhs->getType() != IDENTIFIER) {
+            messages.emplace_back("Illegal variable in assignment");
+        } else if (lhs->toString() == "LET") {
+            messages.emplace_back("SYNTAX ERROR");
+        } else {
+            int var = variable(((IdentifierExp *) lhs)->getId());
+            int result = compileExp(compound->getRHS(), var, temp);
+            if (result != var || compound->getRHS()->getType() == IDENTIFIER) emit(REG_MOV, var, result);
+            return var;
+        }
+        emit(REG_ERROR, int(messages.size()) - 1);
+        return temporary(temp);
+    }
+    int left = compileExp(lhs, -1, temp);
+    if (left < int(vars.size()) && compound->getRHS()->hasEffects()) {
+        emit(REG_MOV, temporary(temp), left);
+        left = temporary(temp);
+    }
+    int right = compileExp(compound->getRHS(), -1, temp + 1);
+    if (target == -1) target = temporary(temp);
+    switch (op) {
+        case ADD_OP: emit(REG_ADD, target, left, right); break;
+        case SUB_OP: emit(REG_SUB, target, left, right); break;
+        case MUL_OP: emit(REG_MUL, target, left, right); break;
+        default: emit(REG_DIV, target, left, right); break;
+    }
+    return target;
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * Sets up the register file.  Constants and temporaries are marked as
+ * defined once, so the interpreter can check every operand the same
+ * way without knowing what kind of register it is.  The return lines
+ * of a run taken over from another back end are translated into
+ * instruction indices up front, so RETURN never has to look a line up.
+ */
+
+void RegisterVM::run(EvalState &state, int lineNumber, const std::vector<int> &returnLines) {
+    int n = int(vars.size());
+    int size = n + int(constants.size()) + temps;
+    std::vector<int> regs(size);
+    std::vector<char> defined(size, true);
+    for (int i = 0; i < n; i++) {
+        defined[i] = state.isDefined(vars[i]);
+        if (defined[i]) regs[i] = state.getValue(vars[i]);
+    }
+    for (size_t i = 0; i < constants.size(); i++) regs[n + i] = constants[i];
+    returns.clear();
+    for (int line : returnLines) returns.push(line == -1 ? end : addresses.at(line));
+    auto writeBack = [&]() {
+        for (int i = 0; i < n; i++) {
+            if (defined[i]) state.setValue(vars[i], regs[i]);
+        }
+    };
+    try {
+        execute(regs.data(), defined.data(), lineNumber == -1 ? 0 : addresses.at(lineNumber));
+    } catch (ErrorException &ex) {
+        writeBack();
+        throw;
+    }
+    writeBack();
+}
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * The dispatch loop.  Arithmetic reads both operands before checking
+ * either, mirroring the order in which CompoundExp::eval fails.
+ */
+
+void RegisterVM::execute(int *regs, char *defined, int start) {
+    const Instruction *pc = code.data() + start;
+    while (true) {
+        const Instruction &in = *pc++;
+        switch (in.op) {
+            case REG_MOV:
+                if (!defined[in.b]) error("VARIABLE NOT DEFINED");
+                regs[in.a] = regs[in.b];
+                defined[in.a] = true;
+                break;
+            case REG_NEG:
+                if (!defined[in.b]) error("VARIABLE NOT DEFINED");
+                regs[in.a] = 0 - regs[in.b];
+                defined[in.a] = true;
+                break;
+            case REG_ADD:
+            case REG_SUB:
+            case REG_MUL:
+            case REG_DIV: {
+                if (!defined[in.b] || !defined[in.c]) error("VARIABLE NOT DEFINED");
+                int left = regs[in.b], right = regs[in.c];
+                switch (in.op) {
+                    case REG_ADD: regs[in.a] = left + right; break;
+                    case REG_SUB: regs[in.a] = left - right; break;
+                    case REG_MUL: regs[in.a] = left * right; break;
+                    default:
+                        if (right == 0) error("DIVIDE BY ZERO");
+                        regs[in.a] = left / right;
+                        break;
+                }
+                defined[in.a] = true;
+                break;
+            }
+            case REG_JUMP:
+                pc = code.data() + in.a;
+                break;
+            case REG_JLT:
+                if (!defined[in.b] || !defined[in.c]) error("VARIABLE NOT DEFINED");
+                if (regs[in.b] < regs[in.c]) pc = code.data() + in.a;
+                break;
+            case REG_JEQ:
+                if (!defined[in.b] || !defined[in.c]) error("VARIABLE NOT DEFINED");
+                if (regs[in.b] == regs[in.c]) pc = code.data() + in.a;
+                break;
+            case REG_JGT:
+                if (!defined[in.b] || !defined[in.c]) error("VARIABLE NOT DEFINED");
+                if (regs[in.b] > regs[in.c]) pc = code.data() + in.a;
+                break;
+            case REG_GOSUB:
+                returns.push(int(pc - code.data()));
+                pc = code.data() + in.a;
+                break;
+            case REG_RETURN:
+                pc = code.data() + returns.pop();
+                break;
+            case REG_PRINT:
+                if (!defined[in.a]) error("VARIABLE NOT DEFINED");
+                std::cout << regs[in.a] << '\n';
+                break;
+            case REG_INPUT:
+                regs[in.a] = readInputValue();
+                defined[in.a] = true;
+                break;
+            case REG_ERROR:
+                error(messages[in.a]);
+                break;
+            case REG_LINE_ERROR:
+                std::cout << "LINE NUMBER ERROR\n";
+                return;
+            case REG_HALT:
+                return;
+        }
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ * File: regvm.h
+ * -------------
+ * This interface exports the RegisterVM class, an alternative to
+ * StackVM in which every variable and constant of the program lives in
+ * a fixed register and each instruction names its operands directly.
+ * It is selected with RUN REGISTER.
+ */
+
+#ifndef _regvm_h
+#define _regvm_h
+
+#include <string>
+#include <vector>
+#include <map>
+#include "evalstate.hpp"
+#include "exp.hpp"
+#include "statement.hpp"
+#include "program.hpp"
+#include "returnstack.hpp"
+
+/*
+ * Type: RegisterOpcode
+ * --------------------
+ * The instructions understood by the register machine.  Every
+ * instruction has the same three operands a, b and c:
+ *
+ *  REG_MOV a, b         -- a = b
+ *  REG_NEG a, b         -- a = -b
+ *  REG_ADD a, b, c      -- a = b + c, and likewise for SUB, MUL, DIV
+ *  REG_JUMP a           -- continue at instruction a
+ *  REG_JLT a, b, c      -- continue at instruction a if b < c, and
+ *                          likewise for JEQ, JGT
+ *  REG_GOSUB a          -- push the next instruction on the return
+ *                          stack and continue at instruction a
+ *  REG_RETURN           -- continue at an instruction popped off the
+ *                          return stack
+ *  REG_PRINT a          -- print a
+ *  REG_INPUT a          -- prompt for a value and store it in a
+ *  REG_ERROR a          -- raise the error whose message is a
+ *  REG_LINE_ERROR       -- print LINE NUMBER ERROR and stop
+ *  REG_HALT             -- stop
+ */
+
+enum RegisterOpcode {
+    REG_MOV, REG_NEG,
+    REG_ADD, REG_SUB, REG_MUL, REG_DIV,
+    REG_JUMP, REG_JLT, REG_JEQ, REG_JGT, REG_GOSUB, REG_RETURN,
+    REG_PRINT, REG_INPUT,
+    REG_ERROR, REG_LINE_ERROR, REG_HALT
+};
+
+/*
+ * Class: RegisterVM
+ * -----------------
+ * A compiled form of a Program.  The register file is laid out as the
+ * program's variables, then its constants, then the temporaries needed
+ * for nested subexpressions, so LET c = a + b becomes the single
+ * instruction REG_ADD c, a, b.  A register is checked for definedness
+ * whenever it is read, which is what raises VARIABLE NOT DEFINED.
+ */
+
+class RegisterVM {
+
+public:
+
+/*
+ * Constructor: RegisterVM
+ * Usage: RegisterVM vm(program);
+ * ------------------------------
+ * Compiles the parsed statements of program.
+ */
+
+    RegisterVM(Program &program);
+
+/*
+ * Method: run
+ * Usage: vm.run(state);
+ *        vm.run(state, lineNumber, returnLines);
+ * ----------------------------------------------
+ * Executes the compiled program.  As with StackVM, variables are read
+ * from state on entry and written back on exit.  If a line number is
+ * given, execution starts at that line instead of the first, which is
+ * how a run that is already in progress moves onto this back end;
+ * returnLines then lists its GOSUB calls in progress, in the form
+ * returned by Program::getReturnLines.
+ */
+
+    void run(EvalState &state, int lineNumber = -1, const std::vector<int> &returnLines = {});
+
+private:
+
+/*
+ * Private type: Instruction
+ * -------------------------
+ * One instruction of the register machine.
+ */
+
+    struct Instruction {
+        int op;
+        int a, b, c;
+    };
+
+    std::vector<Instruction> code;       /* The compiled program       */
+    std::map<int, int> addresses;        /* Instruction of each line   */
+    std::vector<int> vars;               /* Variable IDs by register   */
+    std::vector<int> slots;              /* Variable registers by ID   */
+    std::vector<int> constants;          /* Values of the constants    */
+    std::map<int, int> constantSlots;    /* Constant indices by value  */
+    std::vector<std::string> messages;   /* Messages for REG_ERROR     */
+    int temps = 0;                       /* Number of temporaries      */
+    int end = -1;                        /* The final REG_HALT         */
+    ReturnStack returns;                 /* Instructions to RETURN to  */
+
+/* Private method prototypes */
+
+    int variable(int id);
+
+    int constant(int value);
+
+    int temporary(int index);
+
+    void emit(int op, int a = 0, int b = 0, int c = 0);
+
+    void allocate(Statement *stmt);
+
+    void allocate(Expression *exp);
+
+    void compileStatement(Statement *stmt, std::vector<int> &jumps);
+
+    int compileExp(Expression *exp, int target, int temp);
+
+    void execute(int *regs, char *defined, int start);
+
+};
+
+#endif
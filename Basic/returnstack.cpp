@@ -0,0 +1,56 @@
+/*
+ * File: returnstack.cpp
+ * ---------------------
+ * This file implements the ReturnStack class.
+ */
+
+#include <algorithm>
+#include "returnstack.hpp"
+#include "Utils/error.hpp"
+
+
+/*
+ * Implementation notes: chunks
+ * ----------------------------
+ * push and pop only compare top against the bounds of the top chunk,
+ * and call out of line to move to the next or previous chunk.  The
+ * limit of the chunk that holds entry MAX_GOSUB_DEPTH stops short at
+ * that entry, so the depth limit costs nothing on the inline path.
+ */
+
+static_assert(MAX_GOSUB_DEPTH >= 0, "BASIC_GOSUB_DEPTH must not be negative");
+
+ReturnStack::ReturnStack() {
+    chunks.emplace_back(new int[CHUNK_SIZE]);
+    setChunk(0);
+}
+
+void ReturnStack::setChunk(int index) {
+    chunk = index;
+    base = top = chunks[index].get();
+    limit = base + std::min(CHUNK_SIZE, MAX_GOSUB_DEPTH - index * CHUNK_SIZE);
+}
+
+void ReturnStack::nextChunk() {
+    if (size() >= MAX_GOSUB_DEPTH) error("GOSUB STACK OVERFLOW");
+    if (size_t(chunk) + 1 == chunks.size()) chunks.emplace_back(new int[CHUNK_SIZE]);
+    setChunk(chunk + 1);
+}
+
+void ReturnStack::previousChunk() {
+    if (chunk == 0) error("RETURN WITHOUT GOSUB");
+    setChunk(chunk - 1);
+    top = limit;
+}
+
+int ReturnStack::size() {
+    return chunk * CHUNK_SIZE + int(top - base);
+}
+
+int ReturnStack::get(int depth) {
+    return chunks[depth / CHUNK_SIZE][depth % CHUNK_SIZE];
+}
+
+void ReturnStack::clear() {
+    setChunk(0);
+}
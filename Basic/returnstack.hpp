@@ -0,0 +1,123 @@
+/*
+ * File: returnstack.h
+ * -------------------
+ * This interface exports the ReturnStack class, which holds the return
+ * points of the GOSUB calls in progress, together with the limit on how
+ * deeply such calls may be nested.
+ */
+
+#ifndef _returnstack_h
+#define _returnstack_h
+
+#include <memory>
+#include <vector>
+
+#ifndef BASIC_GOSUB_DEPTH
+#define BASIC_GOSUB_DEPTH 10000
+#endif
+
+/*
+ * Constant: MAX_GOSUB_DEPTH
+ * -------------------------
+ * The number of GOSUB calls that may be in progress at once.  One more
+ * raises GOSUB STACK OVERFLOW.  The limit is fixed when the interpreter
+ * is built, through the BASIC_GOSUB_DEPTH option.
+ */
+
+const int MAX_GOSUB_DEPTH = BASIC_GOSUB_DEPTH;
+
+/*
+ * Class: ReturnStack
+ * ------------------
+ * A stack of return points, each an int whose meaning is up to the
+ * back end that pushes it, such as a block index or a code address.
+ * Entries are stored in chunks of fixed size.  The first chunk is
+ * allocated with the stack, and further ones when a GOSUB first needs
+ * them; a chunk is kept once allocated, so a stack that is reused from
+ * run to run stops allocating after the deepest run so far.
+ */
+
+class ReturnStack {
+
+public:
+
+/*
+ * Constructor: ReturnStack
+ * Usage: ReturnStack returns;
+ * ---------------------------
+ * Creates an empty stack with its first chunk already allocated.
+ */
+
+    ReturnStack();
+
+    ReturnStack(const ReturnStack &) = delete;
+
+    ReturnStack &operator=(const ReturnStack &) = delete;
+
+/*
+ * Method: push
+ * Usage: returns.push(point);
+ * ---------------------------
+ * Pushes a return point, raising GOSUB STACK OVERFLOW if MAX_GOSUB_DEPTH
+ * return points are already on the stack.
+ */
+
+    void push(int point) {
+        if (top == limit) nextChunk();
+        *top++ = point;
+    }
+
+/*
+ * Method: pop
+ * Usage: int point = returns.pop();
+ * ---------------------------------
+ * Removes and returns the most recent return point, raising RETURN
+ * WITHOUT GOSUB if the stack is empty.
+ */
+
+    int pop() {
+        if (top == base) previousChunk();
+        return *--top;
+    }
+
+/*
+ * Methods: size, get
+ * Usage: for (int i = 0; i < returns.size(); i++) . . . returns.get(i)
+ * --------------------------------------------------------------------
+ * Return the number of return points and the one at the given depth,
+ * counted from the bottom of the stack.  They are used to hand the
+ * calls in progress from one back end to another.
+ */
+
+    int size();
+
+    int get(int depth);
+
+/*
+ * Method: clear
+ * Usage: returns.clear();
+ * -----------------------
+ * Empties the stack, keeping its chunks for reuse.
+ */
+
+    void clear();
+
+private:
+
+    static constexpr int CHUNK_SIZE = 256;
+
+    std::vector<std::unique_ptr<int[]>> chunks;  /* Every chunk allocated  */
+    int chunk = 0;                               /* Index of the top chunk */
+    int *base = nullptr;                         /* Start of that chunk    */
+    int *top = nullptr;                          /* Next free entry        */
+    int *limit = nullptr;                        /* End of usable entries  */
+
+    void setChunk(int index);
+
+    void nextChunk();
+
+    void previousChunk();
+
+};
+
+#endif
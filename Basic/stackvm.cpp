@@ -0,0 +1,348 @@
+/*
+ * File: stackvm.cpp
+ * -----------------
+ * This file implements the StackVM class.
+ */
+
+#include <iostream>
+#include "stackvm.hpp"
+#include "cfg.hpp"
+
+
+/*
+ * Implementation notes: constructor
+ * ---------------------------------
+ * The program is compiled one line at a time in line-number order,
+ * skipping the lines that the control flow graph shows to be dead.
+ * Jumps are first emitted with the target line number as operand and
+ * are patched once every line has an address.  A jump to a line that
+ * does not exist is sent to an OP_LINE_ERROR placed after the final
+ * OP_HALT, so the error only appears if the jump is actually taken.
+ */
+
+StackVM::StackVM(Program &program) {
+    std::map<int, int> addresses;
+    std::vector<int> jumps;
+    for (BasicBlock &block : program.getControlFlowGraph().getBlocks()) {
+        for (size_t i = 0; i < block.lines.size(); i++) {
+            addresses[block.lines[i]] = int(code.size());
+            compileStatement(block.statements[i], jumps);
+        }
+    }
+    emit(OP_HALT);
+    int lineError = int(code.size());
+    emit(OP_LINE_ERROR);
+    for (int jump : jumps) {
+        auto it = addresses.find(code[jump]);
+        code[jump] = (it == addresses.end()) ? lineError : it->second;
+    }
+}
+
+int StackVM::variable(int id) {
+    if (size_t(id) >= slots.size()) slots.resize(id + 1, -1);
+    if (slots[id] != -1) return slots[id];
+    vars.push_back(id);
+    return slots[id] = int(vars.size()) - 1;
+}
+
+void StackVM::emit(int op) {
+    code.push_back(op);
+}
+
+void StackVM::emit(int op, int operand) {
+    code.push_back(op);
+    code.push_back(operand);
+}
+
+/*
+ * Implementation notes: compileStatement
+ * --------------------------------------
+ * Each statement leaves the operand stack empty.  The operand of every
+ * jump is recorded in jumps by its position in the code.  The address
+ * that OP_GOSUB pushes is simply the code of the following line, or
+ * the final OP_HALT if there is none.
+ */
+
+void StackVM::compileStatement(Statement *stmt, std::vector<int> &jumps) {
+    switch (stmt->getType()) {
+        case REM_STMT:
+            break;
+        case LET_STMT: {
+            auto *let = (LetStmt *) stmt;
+            compileExp(let->getExp(), 0);
+            emit(OP_STORE, variable(let->getVarId()));
+            break;
+        }
+        case PRINT_STMT:
+            compileExp(((PrintStmt *) stmt)->getExp(), 0);
+            emit(OP_PRINT);
+            break;
+        case INPUT_STMT:
+            emit(OP_INPUT, variable(((InputStmt *) stmt)->getVarId()));
+            break;
+        case END_STMT:
+            emit(OP_HALT);
+            break;
+        case GOTO_STMT:
+            emit(OP_JUMP, ((GotoStmt *) stmt)->getLineNumber());
+            jumps.push_back(int(code.size()) - 1);
+            break;
+        case GOSUB_STMT:
+            emit(OP_GOSUB, ((GosubStmt *) stmt)->getLineNumber());
+            jumps.push_back(int(code.size()) - 1);
+            break;
+        case RETURN_STMT:
+            emit(OP_RETURN);
+            break;
+        case IF_STMT: {
+            auto *ifStmt = (IfStmt *) stmt;
+            compileExp(ifStmt->getLHS(), 0);
+            compileExp(ifStmt->getRHS(), 1);
+            switch (ifStmt->getComparison()) {
+                case LT_CMP: emit(OP_JLT, ifStmt->getLineNumber()); break;
+                case EQ_CMP: emit(OP_JEQ, ifStmt->getLineNumber()); break;
+                case GT_CMP: emit(OP_JGT, ifStmt->getLineNumber()); break;
+            }
+            jumps.push_back(int(code.size()) - 1);
+            break;
+        }
+    }
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * Emits code that leaves the value of exp on top of the stack, given
+ * that depth values are already there.  Assignments are checked the
+ * same way CompoundExp::eval checks them, but the resulting error is
+ * compiled into an OP_ERROR so that it is raised only if reached.
+ */
+
+void StackVM::compileExp(Expression *exp, int depth) {
+    if (depth + 2 > maxDepth) maxDepth = depth + 2;
+    switch (exp->getType()) {
+        case CONSTANT:
+            emit(OP_PUSH, ((ConstantExp *) exp)->getValue());
+            return;
+        case IDENTIFIER:
+            emit(OP_LOAD, variable(((IdentifierExp *) exp)->getId()));
+            return;
+        case NEGATE:
+            compileExp(((NegateExp *) exp)->getOperand(), depth);
+            emit(OP_NEG);
+            return;
+        case COMPOUND:
+            break;
+    }
+    auto *compound = (CompoundExp *) exp;
+    Operator op = compound->getOp();
+    Expression *lhs = compound->getLHS();
+    if (op == ASSIGN_OP) {
+        if (lhs->getType() != IDENTIFIER) {
+            messages.emplace_back("Illegal variable in assignment");
+            emit(OP_ERROR, int(messages.size()) - 1);
+        } else if (lhs->toString() == "LET") {
+            messages.emplace_back("SYNTAX ERROR");
+            emit(OP_ERROR, int(messages.size()) - 1);
+        } else {
+            compileExp(compound->getRHS(), depth);
+            emit(OP_DUP);
+            emit(OP_STORE, variable(((IdentifierExp *) lhs)->getId()));
+        }
+        return;
+    }
+    compileExp(lhs, depth);
+    compileExp(compound->getRHS(), depth + 1);
+    switch (op) {
+        case ADD_OP: emit(OP_ADD); break;
+        case SUB_OP: emit(OP_SUB); break;
+        case MUL_OP: emit(OP_MUL); break;
+        default: emit(OP_DIV); break;
+    }
+}
+
+/*
+ * Implementation notes: run
+ * -------------------------
+ * The variables used by the program are copied out of the EvalState
+ * into a dense array for the duration of the run and copied back when
+ * the program stops for any reason.
+ */
+
+void StackVM::run(EvalState &state) {
+    int n = int(vars.size());
+    std::vector<int> values(n);
+    std::vector<char> defined(n);
+    for (int i = 0; i < n; i++) {
+        defined[i] = state.isDefined(vars[i]);
+        if (defined[i]) values[i] = state.getValue(vars[i]);
+    }
+    auto writeBack = [&]() {
+        for (int i = 0; i < n; i++) {
+            if (defined[i]) state.setValue(vars[i], values[i]);
+        }
+    };
+    std::vector<int> stack(maxDepth + 1);
+    returns.clear();
+    try {
+        execute(values.data(), defined.data(), stack.data());
+    } catch (ErrorException &ex) {
+        writeBack();
+        throw;
+    }
+    writeBack();
+}
+
+/*
+ * Implementation notes: execute
+ * -----------------------------
+ * The dispatch loop.  sp points one past the top of the operand stack.
+ *
+ * When BASIC_THREADED_DISPATCH is defined and the compiler supports
+ * labels as values, the code array is first translated into threaded
+ * code in which each opcode is replaced by the address of its handler,
+ * and every handler ends with its own indirect jump to the next one.
+ * Operands and jump targets keep their positions, so the same handler
+ * bodies serve both forms of the loop.  Otherwise a portable switch is
+ * used.
+ */
+
+#if defined(BASIC_THREADED_DISPATCH) && defined(__GNUC__)
+#define THREADED_DISPATCH
+#endif
+
+#ifdef THREADED_DISPATCH
+#define CASE(op) L_##op:
+#define NEXT() goto *(const void *) *pc++
+
+static int operandCount(int op) {
+    switch (op) {
+        case OP_PUSH:
+        case OP_LOAD:
+        case OP_STORE:
+        case OP_JUMP:
+        case OP_JLT:
+        case OP_JEQ:
+        case OP_JGT:
+        case OP_GOSUB:
+        case OP_INPUT:
+        case OP_ERROR:
+            return 1;
+        default:
+            return 0;
+    }
+}
+#else
+#define CASE(op) case op:
+#define NEXT() break
+#endif
+
+void StackVM::execute(int *values, char *defined, int *stack) {
+    int *sp = stack;
+#ifdef THREADED_DISPATCH
+    static const void *const labels[] = {
+        &&L_OP_PUSH, &&L_OP_LOAD, &&L_OP_STORE, &&L_OP_DUP,
+        &&L_OP_ADD, &&L_OP_SUB, &&L_OP_MUL, &&L_OP_DIV, &&L_OP_NEG,
+        &&L_OP_JUMP, &&L_OP_JLT, &&L_OP_JEQ, &&L_OP_JGT, &&L_OP_GOSUB, &&L_OP_RETURN,
+        &&L_OP_PRINT, &&L_OP_INPUT,
+        &&L_OP_ERROR, &&L_OP_LINE_ERROR, &&L_OP_HALT
+    };
+    if (threaded.empty()) {
+        threaded.resize(code.size());
+        for (size_t i = 0; i < code.size(); i += 1 + operandCount(code[i])) {
+            threaded[i] = intptr_t(labels[code[i]]);
+            for (int j = 1; j <= operandCount(code[i]); j++) threaded[i + j] = code[i + j];
+        }
+    }
+    const intptr_t *base = threaded.data();
+    const intptr_t *pc = base;
+    NEXT();
+#else
+    const int *base = code.data();
+    const int *pc = base;
+    while (true) {
+        switch (*pc++) {
+#endif
+            CASE(OP_PUSH)
+                *sp++ = *pc++;
+                NEXT();
+            CASE(OP_LOAD)
+                if (!defined[*pc]) error("VARIABLE NOT DEFINED");
+                *sp++ = values[*pc++];
+                NEXT();
+            CASE(OP_STORE)
+                values[*pc] = *--sp;
+                defined[*pc++] = true;
+                NEXT();
+            CASE(OP_DUP)
+                *sp = sp[-1];
+                sp++;
+                NEXT();
+            CASE(OP_ADD)
+                sp--;
+                sp[-1] += *sp;
+                NEXT();
+            CASE(OP_SUB)
+                sp--;
+                sp[-1] -= *sp;
+                NEXT();
+            CASE(OP_MUL)
+                sp--;
+                sp[-1] *= *sp;
+                NEXT();
+            CASE(OP_DIV)
+                sp--;
+                if (*sp == 0) error("DIVIDE BY ZERO");
+                sp[-1] /= *sp;
+                NEXT();
+            CASE(OP_NEG)
+                sp[-1] = 0 - sp[-1];
+                NEXT();
+            CASE(OP_JUMP)
+                pc = base + *pc;
+                NEXT();
+            CASE(OP_JLT)
+                sp -= 2;
+                if (sp[0] < sp[1]) pc = base + *pc;
+                else pc++;
+                NEXT();
+            CASE(OP_JEQ)
+                sp -= 2;
+                if (sp[0] == sp[1]) pc = base + *pc;
+                else pc++;
+                NEXT();
+            CASE(OP_JGT)
+                sp -= 2;
+                if (sp[0] > sp[1]) pc = base + *pc;
+                else pc++;
+                NEXT();
+            CASE(OP_GOSUB)
+                returns.push(int(pc + 1 - base));
+                pc = base + *pc;
+                NEXT();
+            CASE(OP_RETURN)
+                pc = base + returns.pop();
+                NEXT();
+            CASE(OP_PRINT)
+                std::cout << *--sp << '\n';
+                NEXT();
+            CASE(OP_INPUT)
+                values[*pc] = readInputValue();
+                defined[*pc++] = true;
+                NEXT();
+            CASE(OP_ERROR)
+                error(messages[*pc]);
+                NEXT();
+            CASE(OP_LINE_ERROR)
+                std::cout << "LINE NUMBER ERROR\n";
+                return;
+            CASE(OP_HALT)
+                return;
+#ifndef THREADED_DISPATCH
+        }
+    }
+#endif
+}
+
+#undef CASE
+#undef NEXT
@@ -0,0 +1,118 @@
+/*
+ * File: stackvm.h
+ * ---------------
+ * This interface exports the StackVM class, which compiles a whole
+ * BASIC program into a flat array of bytecode and runs it on a small
+ * stack machine.  It is selected with RUN STACK; plain RUN goes
+ * through runTiered, which starts in the statement interpreter and
+ * moves hot programs to NativeCode or RegisterVM.
+ */
+
+#ifndef _stackvm_h
+#define _stackvm_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include "evalstate.hpp"
+#include "exp.hpp"
+#include "statement.hpp"
+#include "program.hpp"
+#include "returnstack.hpp"
+
+/*
+ * Type: Opcode
+ * ------------
+ * The instructions understood by the stack machine.  Each opcode is
+ * stored in the code array followed by its operand, if it has one:
+ *
+ *  OP_PUSH k        -- push the constant k
+ *  OP_LOAD v        -- push variable v, or fail if it is not defined
+ *  OP_STORE v       -- pop a value into variable v
+ *  OP_DUP           -- duplicate the top of the stack
+ *  OP_ADD ... OP_DIV -- pop two values and push the result
+ *  OP_NEG           -- replace the top of the stack by its negation
+ *  OP_JUMP pc       -- continue at pc
+ *  OP_JLT pc        -- pop two values and continue at pc if the first
+ *                      is less than the second, and likewise for JEQ, JGT
+ *  OP_GOSUB pc      -- push the address of the next instruction on the
+ *                      return stack and continue at pc
+ *  OP_RETURN        -- continue at an address popped off the return stack
+ *  OP_PRINT         -- pop a value and print it
+ *  OP_INPUT v       -- prompt for a value and store it in variable v
+ *  OP_ERROR m       -- raise the error whose message is m
+ *  OP_LINE_ERROR    -- print LINE NUMBER ERROR and stop
+ *  OP_HALT          -- stop
+ */
+
+enum Opcode {
+    OP_PUSH, OP_LOAD, OP_STORE, OP_DUP,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_NEG,
+    OP_JUMP, OP_JLT, OP_JEQ, OP_JGT, OP_GOSUB, OP_RETURN,
+    OP_PRINT, OP_INPUT,
+    OP_ERROR, OP_LINE_ERROR, OP_HALT
+};
+
+/*
+ * Class: StackVM
+ * --------------
+ * A compiled form of a Program.  Variables are numbered when the
+ * program is compiled and every jump target is resolved to an index in
+ * the code array, so running the program involves no string compares
+ * and no allocation beyond the operand stack and variable array set up
+ * on entry.
+ */
+
+class StackVM {
+
+public:
+
+/*
+ * Constructor: StackVM
+ * Usage: StackVM vm(program);
+ * ---------------------------
+ * Compiles the parsed statements of program.  The program may be
+ * changed or destroyed afterwards without affecting the compiled code.
+ */
+
+    StackVM(Program &program);
+
+/*
+ * Method: run
+ * Usage: vm.run(state);
+ * ---------------------
+ * Executes the compiled program.  Variables are read from state on
+ * entry and written back on exit, including when an error stops the
+ * program, so the behavior matches Program::Run.
+ */
+
+    void run(EvalState &state);
+
+private:
+
+    std::vector<int> code;               /* Opcodes and their operands */
+    std::vector<intptr_t> threaded;      /* Threaded form of code      */
+    std::vector<int> vars;               /* Variable IDs by number     */
+    std::vector<int> slots;              /* Variable numbers by ID     */
+    std::vector<std::string> messages;   /* Messages for OP_ERROR      */
+    int maxDepth = 0;                    /* Deepest operand stack      */
+    ReturnStack returns;                 /* Addresses to RETURN to     */
+
+/* Private method prototypes */
+
+    int variable(int id);
+
+    void emit(int op);
+
+    void emit(int op, int operand);
+
+    void compileStatement(Statement *stmt, std::vector<int> &jumps);
+
+    void compileExp(Expression *exp, int depth);
+
+    void execute(int *values, char *defined, int *stack);
+
+};
+
+#endif
@@ -8,17 +8,378 @@
  */
 
 #include "statement.hpp"
+#include "fold.hpp"
+#include "keyword.hpp"
 
 
 /* Implementation of the Statement class */
 
-int stringToInt(std::string str);
-
 Statement::Statement() = default;
 
 Statement::~Statement() = default;
 
-//todo
-/*LET::LET() {
+void *Statement::operator new(size_t size, Arena &arena) {
+    return arena.allocate(size);
+}
+
+void Statement::operator delete(void *, Arena &) {
+    /* Empty */
+}
+
+void Statement::operator delete(void *) {
+    /* Empty */
+}
+
+/*
+ * Implementation notes: parsing helpers
+ * -------------------------------------
+ * The statement constructors share a handful of small checks.  Each of
+ * them reports failure with error, which parseStatement turns into the
+ * SYNTAX ERROR message the user sees.
+ */
+
+static std::string readVariable(TokenScanner &scanner) {
+    std::string var = scanner.nextToken();
+    if (scanner.getTokenType(var) != WORD || lookupKeyword(var) != NO_KEYWORD) error("SYNTAX ERROR");
+    return var;
+}
+
+static int readLineNumber(TokenScanner &scanner) {
+    std::string token = scanner.nextToken();
+    if (scanner.getTokenType(token) != NUMBER) error("SYNTAX ERROR");
+    return parseIntegerLiteral(token);
+}
+
+static void checkEndOfLine(TokenScanner &scanner) {
+    if (scanner.hasMoreTokens()) error("SYNTAX ERROR");
+}
+
+/*
+ * Implementation notes: RemStmt
+ * -----------------------------
+ * The text of a comment is kept only in the program's source line, so
+ * the constructor just discards whatever tokens remain.
+ */
+
+RemStmt::RemStmt(TokenScanner &scanner) {
+    while (scanner.hasMoreTokens()) scanner.nextToken();
+}
+
+void RemStmt::execute(EvalState &state, Program &program) {
+    /* Empty */
+}
+
+StatementType RemStmt::getType() {
+    return REM_STMT;
+}
+
+/*
+ * Implementation notes: LetStmt
+ * -----------------------------
+ * The expression after the equal sign is read with readE, so it may
+ * itself contain an assignment, just as in immediate mode.  As in every
+ * statement, the expression is folded once here rather than each time
+ * the line runs.
+ */
+
+LetStmt::LetStmt(TokenScanner &scanner, Arena &arena) {
+    varId = EvalState::intern(readVariable(scanner));
+    if (scanner.nextToken() != "=") error("SYNTAX ERROR");
+    exp = foldConstants(readE(scanner, arena), arena);
+    checkEndOfLine(scanner);
+}
+
+void LetStmt::execute(EvalState &state, Program &program) {
+    state.setValue(varId, exp->eval(state));
+}
+
+StatementType LetStmt::getType() {
+    return LET_STMT;
+}
+
+std::string LetStmt::getVar() {
+    return EvalState::getName(varId);
+}
+
+int LetStmt::getVarId() {
+    return varId;
+}
+
+Expression *LetStmt::getExp() {
+    return exp;
+}
+
+/*
+ * Implementation notes: PrintStmt
+ * -------------------------------
+ * PRINT takes exactly one expression.
+ */
+
+PrintStmt::PrintStmt(TokenScanner &scanner, Arena &arena) {
+    exp = foldConstants(readE(scanner, arena), arena);
+    checkEndOfLine(scanner);
+}
+
+void PrintStmt::execute(EvalState &state, Program &program) {
+    std::cout << exp->eval(state) << '\n';
+}
+
+StatementType PrintStmt::getType() {
+    return PRINT_STMT;
+}
+
+Expression *PrintStmt::getExp() {
+    return exp;
+}
+
+/*
+ * Implementation notes: readInputValue
+ * ------------------------------------
+ * The value is read from std::cin, one line per attempt.  A reply is
+ * accepted if it is an optional minus sign followed by digits whose
+ * value fits in an int; anything else, including a number that is out
+ * of range, prints INVALID NUMBER and prompts again.
+ */
+
+int readInputValue() {
+    while (true) {
+        std::cout << " ? ";
+        std::string num;
+        getline(std::cin, num);
+        int value;
+        if (parseInteger(num, value) == INTEGER_OK) return value;
+        std::cout << "INVALID NUMBER\n";
+    }
+}
+
+/*
+ * Implementation notes: InputStmt
+ * -------------------------------
+ * The prompting is shared with the compiled back ends through
+ * readInputValue.
+ */
+
+InputStmt::InputStmt(TokenScanner &scanner) {
+    varId = EvalState::intern(readVariable(scanner));
+    checkEndOfLine(scanner);
+}
+
+void InputStmt::execute(EvalState &state, Program &program) {
+    state.setValue(varId, readInputValue());
+}
+
+StatementType InputStmt::getType() {
+    return INPUT_STMT;
+}
+
+std::string InputStmt::getVar() {
+    return EvalState::getName(varId);
+}
+
+int InputStmt::getVarId() {
+    return varId;
+}
+
+/*
+ * Implementation notes: EndStmt
+ * -----------------------------
+ * END simply tells the program to stop after this statement.
+ */
+
+EndStmt::EndStmt(TokenScanner &scanner) {
+    checkEndOfLine(scanner);
+}
+
+void EndStmt::execute(EvalState &state, Program &program) {
+    program.halt();
+}
+
+StatementType EndStmt::getType() {
+    return END_STMT;
+}
+
+/*
+ * Implementation notes: GotoStmt
+ * ------------------------------
+ * The target is not checked here.  A missing line is reported as
+ * LINE NUMBER ERROR by Program::Run only if the jump is taken.
+ */
+
+GotoStmt::GotoStmt(TokenScanner &scanner) {
+    lineNumber = readLineNumber(scanner);
+    checkEndOfLine(scanner);
+}
+
+void GotoStmt::execute(EvalState &state, Program &program) {
+    program.jumpTo(lineNumber);
+}
+
+StatementType GotoStmt::getType() {
+    return GOTO_STMT;
+}
+
+int GotoStmt::getLineNumber() {
+    return lineNumber;
+}
+
+/*
+ * Implementation notes: IfStmt
+ * ----------------------------
+ * Both operands are read with readE(scanner, 1) so that the parser
+ * stops in front of the relational operator instead of treating = as
+ * an assignment.  readIf then picks the subclass for the operator, and
+ * the comparison is fixed from then on: execute evaluates the left
+ * operand before the right one and tests them directly.
+ */
+
+static IfStmt *readIf(TokenScanner &scanner, Arena &arena) {
+    Expression *lhs = foldConstants(readE(scanner, arena, 1), arena);
+    std::string_view token = scanner.nextTokenView();
+    if (token != "=" && token != "<" && token != ">") error("SYNTAX ERROR");
+    char op = token[0];
+    Expression *rhs = foldConstants(readE(scanner, arena, 1), arena);
+    if (lookupKeyword(scanner.nextTokenView()) != THEN_KW) error("SYNTAX ERROR");
+    int lineNumber = readLineNumber(scanner);
+    checkEndOfLine(scanner);
+    switch (op) {
+        case '<': return new (arena) IfLessStmt(lhs, rhs, lineNumber);
+        case '=': return new (arena) IfEqualStmt(lhs, rhs, lineNumber);
+        default: return new (arena) IfGreaterStmt(lhs, rhs, lineNumber);
+    }
+}
+
+IfStmt::IfStmt(Comparison cmp, Expression *lhs, Expression *rhs, int lineNumber) {
+    this->cmp = cmp;
+    this->lhs = lhs;
+    this->rhs = rhs;
+    this->lineNumber = lineNumber;
+}
+
+StatementType IfStmt::getType() {
+    return IF_STMT;
+}
+
+Comparison IfStmt::getComparison() {
+    return cmp;
+}
+
+std::string IfStmt::getOp() {
+    switch (cmp) {
+        case LT_CMP: return "<";
+        case EQ_CMP: return "=";
+        case GT_CMP: return ">";
+    }
+    return "";
+}
+
+Expression *IfStmt::getLHS() {
+    return lhs;
+}
+
+Expression *IfStmt::getRHS() {
+    return rhs;
+}
+
+int IfStmt::getLineNumber() {
+    return lineNumber;
+}
+
+IfLessStmt::IfLessStmt(Expression *lhs, Expression *rhs, int lineNumber)
+        : IfStmt(LT_CMP, lhs, rhs, lineNumber) {
+    /* Empty */
+}
+
+void IfLessStmt::execute(EvalState &state, Program &program) {
+    int left = lhs->eval(state);
+    if (left < rhs->eval(state)) program.jumpTo(lineNumber);
+}
+
+IfEqualStmt::IfEqualStmt(Expression *lhs, Expression *rhs, int lineNumber)
+        : IfStmt(EQ_CMP, lhs, rhs, lineNumber) {
+    /* Empty */
+}
+
+void IfEqualStmt::execute(EvalState &state, Program &program) {
+    int left = lhs->eval(state);
+    if (left == rhs->eval(state)) program.jumpTo(lineNumber);
+}
+
+IfGreaterStmt::IfGreaterStmt(Expression *lhs, Expression *rhs, int lineNumber)
+        : IfStmt(GT_CMP, lhs, rhs, lineNumber) {
+    /* Empty */
+}
+
+void IfGreaterStmt::execute(EvalState &state, Program &program) {
+    int left = lhs->eval(state);
+    if (left > rhs->eval(state)) program.jumpTo(lineNumber);
+}
+
+/*
+ * Implementation notes: GosubStmt, ReturnStmt
+ * -------------------------------------------
+ * The return stack belongs to the program being run, which resolves
+ * the line after the GOSUB before pushing it.  As with GOTO, a missing
+ * target is only reported when the call is made.
+ */
+
+GosubStmt::GosubStmt(TokenScanner &scanner) {
+    lineNumber = readLineNumber(scanner);
+    checkEndOfLine(scanner);
+}
+
+void GosubStmt::execute(EvalState &state, Program &program) {
+    program.callSubroutine(lineNumber);
+}
+
+StatementType GosubStmt::getType() {
+    return GOSUB_STMT;
+}
+
+int GosubStmt::getLineNumber() {
+    return lineNumber;
+}
+
+ReturnStmt::ReturnStmt(TokenScanner &scanner) {
+    checkEndOfLine(scanner);
+}
+
+void ReturnStmt::execute(EvalState &state, Program &program) {
+    program.returnFromSubroutine();
+}
+
+StatementType ReturnStmt::getType() {
+    return RETURN_STMT;
+}
+
+/*
+ * Implementation notes: parseStatement
+ * ------------------------------------
+ * Dispatches on the keyword ID, which a switch over the dense Keyword
+ * range turns into a jump table.  Errors raised while parsing, including
+ * those from readE, are all reported to the user as SYNTAX ERROR,
+ * except the NumberRangeException for a literal too large for an int.
+ */
 
-}*/
+Statement *parseStatement(TokenScanner &scanner, Arena &arena) {
+    Keyword keyword = lookupKeyword(scanner.nextTokenView());
+    try {
+        switch (keyword) {
+            case REM_KW: return new (arena) RemStmt(scanner);
+            case LET_KW: return new (arena) LetStmt(scanner, arena);
+            case PRINT_KW: return new (arena) PrintStmt(scanner, arena);
+            case INPUT_KW: return new (arena) InputStmt(scanner);
+            case END_KW: return new (arena) EndStmt(scanner);
+            case GOTO_KW: return new (arena) GotoStmt(scanner);
+            case IF_KW: return readIf(scanner, arena);
+            case GOSUB_KW: return new (arena) GosubStmt(scanner);
+            case RETURN_KW: return new (arena) ReturnStmt(scanner);
+            default: break;
+        }
+    } catch (NumberRangeException &) {
+        throw;
+    } catch (ErrorException &) {
+        error("SYNTAX ERROR");
+    }
+    error("SYNTAX ERROR");
+    return nullptr;
+}
@@ -26,6 +26,30 @@
 
 class Program;
 
+/*
+ * Type: StatementType
+ * -------------------
+ * This enumerated type is used to differentiate the statement forms
+ * supported by the interpreter.  It plays the same role for statements
+ * that ExpressionType plays for expressions.
+ */
+
+enum StatementType {
+    REM_STMT, LET_STMT, PRINT_STMT, INPUT_STMT, END_STMT, GOTO_STMT, IF_STMT,
+    GOSUB_STMT, RETURN_STMT
+};
+
+/*
+ * Type: Comparison
+ * ----------------
+ * The relational operator of an IF statement.  Like Operator, it is
+ * translated from its token once, when the line is parsed.
+ */
+
+enum Comparison {
+    LT_CMP, EQ_CMP, GT_CMP
+};
+
 /*
  * Class: Statement
  * ----------------
@@ -54,16 +78,28 @@ public:
 
 /*
  * Destructor: ~Statement
- * Usage: delete stmt;
- * -------------------
- * The destructor deallocates the storage for this expression.
- * It must be declared virtual to ensure that the correct subclass
- * destructor is called when deleting a statement.
- * 析构函数取消分配此表达式的存储。它必须声明为虚拟的，以确保在删除语句时调用正确的子类析构函数。
+ * ----------------------
+ * Statements never own anything outside their arena, so the destructor
+ * does nothing and is never actually called.
  */
 
     virtual ~Statement();
 
+/*
+ * Operators: new, delete
+ * Usage: Statement *stmt = new (arena) EndStmt(scanner);
+ * ------------------------------------------------------
+ * Like expressions, statements are allocated from an Arena, normally
+ * the one that also holds their expressions.  Deleting a single
+ * statement does nothing.
+ */
+
+    static void *operator new(size_t size, Arena &arena);
+
+    static void operator delete(void *ptr, Arena &arena);
+
+    static void operator delete(void *ptr);
+
 /*
  * Method: execute
  * Usage: stmt->execute(state);
@@ -79,6 +115,16 @@ public:
 
     virtual void execute(EvalState &state, Program &program) = 0;
 
+/*
+ * Method: getType
+ * Usage: StatementType type = stmt->getType();
+ * --------------------------------------------
+ * Returns the type of the statement, which lets clients such as a
+ * compiler inspect a statement without resorting to dynamic_cast.
+ */
+
+    virtual StatementType getType() = 0;
+
 };
 
 
@@ -94,11 +140,276 @@ public:
  * 该文件的其余部分必须由各个语句形式的子类定义组成。
  * 这些子类中的每一个子类都必须定义一个构造函数和一个名为execute的方法，前者解析来自扫描程序的语句，后者执行该语句。
  * 如果子类的私有数据包括堆上分配的数据（如Expression对象），则类实现还必须指定自己的析构函数方法来释放该内存。
+ *
+ * In each case the constructor is called with the scanner positioned
+ * just after the keyword and must consume the rest of the line.
+ * Statements that contain expressions also take the arena in which
+ * those expressions are to be allocated, so none of them needs a
+ * destructor.
+ */
+
+/*
+ * Class: RemStmt
+ * --------------
+ * REM comment -- ignores the remainder of the line.
+ */
+
+class RemStmt : public Statement {
+
+public:
+
+    RemStmt(TokenScanner &scanner);
+
+    virtual void execute(EvalState &state, Program &program);
+
+    virtual StatementType getType();
+
+};
+
+/*
+ * Class: LetStmt
+ * --------------
+ * LET var = exp -- assigns the value of exp to var.
+ */
+
+class LetStmt : public Statement {
+
+public:
+
+    LetStmt(TokenScanner &scanner, Arena &arena);
+
+    virtual void execute(EvalState &state, Program &program);
+
+    virtual StatementType getType();
+
+    std::string getVar();
+
+    int getVarId();
+
+    Expression *getExp();
+
+private:
+
+    int varId;
+    Expression *exp;
+
+};
+
+/*
+ * Class: PrintStmt
+ * ----------------
+ * PRINT exp -- prints the value of exp on its own line.
+ */
+
+class PrintStmt : public Statement {
+
+public:
+
+    PrintStmt(TokenScanner &scanner, Arena &arena);
+
+    virtual void execute(EvalState &state, Program &program);
+
+    virtual StatementType getType();
+
+    Expression *getExp();
+
+private:
+
+    Expression *exp;
+
+};
+
+/*
+ * Class: InputStmt
+ * ----------------
+ * INPUT var -- prompts with " ? " until the user types an integer
+ * and then stores it in var.
+ */
+
+class InputStmt : public Statement {
+
+public:
+
+    InputStmt(TokenScanner &scanner);
+
+    virtual void execute(EvalState &state, Program &program);
+
+    virtual StatementType getType();
+
+    std::string getVar();
+
+    int getVarId();
+
+private:
+
+    int varId;
+
+};
+
+/*
+ * Class: EndStmt
+ * --------------
+ * END -- stops the program.
  */
-/*class LET:public Statement{
+
+class EndStmt : public Statement {
+
+public:
+
+    EndStmt(TokenScanner &scanner);
+
+    virtual void execute(EvalState &state, Program &program);
+
+    virtual StatementType getType();
+
+};
+
+/*
+ * Class: GotoStmt
+ * ---------------
+ * GOTO n -- continues execution at line n.
+ */
+
+class GotoStmt : public Statement {
+
+public:
+
+    GotoStmt(TokenScanner &scanner);
+
+    virtual void execute(EvalState &state, Program &program);
+
+    virtual StatementType getType();
+
+    int getLineNumber();
+
+private:
+
+    int lineNumber;
+
+};
+
+/*
+ * Class: IfStmt
+ * -------------
+ * IF lhs op rhs THEN n -- continues execution at line n when the
+ * comparison holds, where op is one of =, < or >.  The statement is
+ * built as one of the subclasses below, which each test their own
+ * comparison, so running an IF costs one compare and at most one jump.
+ */
+
+class IfStmt : public Statement {
+
+public:
+
+    virtual StatementType getType();
+
+    Comparison getComparison();
+
+    std::string getOp();
+
+    Expression *getLHS();
+
+    Expression *getRHS();
+
+    int getLineNumber();
+
+protected:
+
+    IfStmt(Comparison cmp, Expression *lhs, Expression *rhs, int lineNumber);
+
+    Comparison cmp;
+    Expression *lhs, *rhs;
+    int lineNumber;
+
+};
+
+/*
+ * Classes: IfLessStmt, IfEqualStmt, IfGreaterStmt
+ * -----------------------------------------------
+ * The concrete IF statements, one per comparison.
+ */
+
+class IfLessStmt : public IfStmt {
 public:
-    LET();
-    execute
-};*/
+    IfLessStmt(Expression *lhs, Expression *rhs, int lineNumber);
+    virtual void execute(EvalState &state, Program &program);
+};
+
+class IfEqualStmt : public IfStmt {
+public:
+    IfEqualStmt(Expression *lhs, Expression *rhs, int lineNumber);
+    virtual void execute(EvalState &state, Program &program);
+};
+
+class IfGreaterStmt : public IfStmt {
+public:
+    IfGreaterStmt(Expression *lhs, Expression *rhs, int lineNumber);
+    virtual void execute(EvalState &state, Program &program);
+};
+
+/*
+ * Class: GosubStmt
+ * ----------------
+ * GOSUB n -- continues execution at line n, remembering the line after
+ * this one as the place for the matching RETURN to continue at.
+ */
+
+class GosubStmt : public Statement {
+
+public:
+
+    GosubStmt(TokenScanner &scanner);
+
+    virtual void execute(EvalState &state, Program &program);
+
+    virtual StatementType getType();
+
+    int getLineNumber();
+
+private:
+
+    int lineNumber;
+
+};
+
+/*
+ * Class: ReturnStmt
+ * -----------------
+ * RETURN -- continues execution after the most recent GOSUB that has
+ * not yet returned.
+ */
+
+class ReturnStmt : public Statement {
+
+public:
+
+    ReturnStmt(TokenScanner &scanner);
+
+    virtual void execute(EvalState &state, Program &program);
+
+    virtual StatementType getType();
+
+};
+
+/*
+ * Function: parseStatement
+ * Usage: Statement *stmt = parseStatement(scanner, arena);
+ * --------------------------------------------------------
+ * Reads a keyword from the scanner and builds the matching statement
+ * from the rest of the line, allocating it and its expressions in
+ * arena.  Any malformed statement is reported as SYNTAX ERROR.
+ */
+
+Statement *parseStatement(TokenScanner &scanner, Arena &arena);
+
+/*
+ * Function: readInputValue
+ * Usage: int value = readInputValue();
+ * ------------------------------------
+ * Implements the prompt used by INPUT: prints " ? " and reads lines
+ * from std::cin until one holds a valid integer, which is returned.
+ */
+
+int readInputValue();
 
 #endif
@@ -0,0 +1,34 @@
+/*
+ * File: tiered.cpp
+ * ----------------
+ * This file implements the tiered execution strategy.
+ */
+
+#include "tiered.hpp"
+#include "regvm.hpp"
+#include "jit.hpp"
+
+
+/*
+ * Implementation notes: runTiered
+ * -------------------------------
+ * Every back end loads the variables from the EvalState when it starts
+ * and can begin at any line, so switching tiers in the middle of a run
+ * needs nothing more than the number of the line to resume at and the
+ * lines that the GOSUB calls in progress return to.  The hit counters
+ * live in the program, so a program that was hot in one RUN moves to
+ * compiled code right away in the next.
+ */
+
+void runTiered(Program &program, EvalState &state) {
+    int line = program.runUntilHot(state, HOT_LINE_THRESHOLD);
+    if (line == -1) return;
+    std::vector<int> returnLines = program.getReturnLines();
+    NativeCode native(program);
+    if (native.isCompiled()) {
+        native.run(state, program, line, returnLines);
+    } else {
+        RegisterVM vm(program);
+        vm.run(state, line, returnLines);
+    }
+}
@@ -0,0 +1,37 @@
+/*
+ * File: tiered.h
+ * --------------
+ * This interface exports runTiered, the execution strategy behind the
+ * plain RUN command.  A program starts in the statement interpreter,
+ * which has no start-up cost, and moves to compiled code once one of
+ * its lines turns out to be hot.
+ */
+
+#ifndef _tiered_h
+#define _tiered_h
+
+#include "evalstate.hpp"
+#include "program.hpp"
+
+/*
+ * Constant: HOT_LINE_THRESHOLD
+ * ----------------------------
+ * The number of times a line must run in the statement interpreter
+ * before the program is compiled.
+ */
+
+const long long HOT_LINE_THRESHOLD = 1000;
+
+/*
+ * Function: runTiered
+ * Usage: runTiered(program, state);
+ * ---------------------------------
+ * Runs program with Program::runUntilHot.  If a line becomes hot, the
+ * program is compiled with the best back end available (NativeCode,
+ * otherwise RegisterVM) and the run continues in the compiled code at
+ * that line, with the variables carried over through state.
+ */
+
+void runTiered(Program &program, EvalState &state);
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ * File: transpiler.cpp
+ * --------------------
+ * This file implements the emitCpp function.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <set>
+#include "transpiler.hpp"
+#include "statement.hpp"
+#include "cfg.hpp"
+#include "returnstack.hpp"
+#include "Utils/strlib.hpp"
+
+
+/*
+ * Implementation notes: generated code
+ * ------------------------------------
+ * Expressions are flattened into one local per intermediate result, so
+ * the generated code evaluates operands strictly left to right even
+ * though C++ leaves the order of operands unspecified.  Every variable
+ * read is preceded by a check of its defined flag.  The errors jump to
+ * labels at the end of main, which print the message exactly as the
+ * interpreter's command loop would.
+ *
+ * Only the labels and functions that the program uses are written, and
+ * the variables are marked [[maybe_unused]], so the output compiles
+ * cleanly with -Wall -Wextra.  INPUT_FUNCTION repeats the prompt of
+ * readInputValue so that the translated program accepts exactly the
+ * same replies.
+ */
+
+static const char *PROLOGUE =
+        "#include <charconv>\n"
+        "#include <iostream>\n"
+        "#include <string>\n"
+        "\n";
+
+static const char *INPUT_FUNCTION =
+        "static int readInputValue() {\n"
+        "    while (true) {\n"
+        "        std::cout << \" ? \";\n"
+        "        std::string num;\n"
+        "        getline(std::cin, num);\n"
+        "        int value;\n"
+        "        const char *end = num.data() + num.length();\n"
+        "        auto result = std::from_chars(num.data(), end, value);\n"
+        "        if (result.ec == std::errc() && result.ptr == end) return value;\n"
+        "        std::cout << \"INVALID NUMBER\\n\";\n"
+        "    }\n"
+        "}\n"
+        "\n";
+
+struct ErrorLabel {
+    const char *label;
+    const char *output;
+};
+
+static const ErrorLabel ERROR_LABELS[] = {
+    {"line_error", "\"LINE NUMBER ERROR\\n\""},
+    {"undefined_error", "\"VARIABLE NOT DEFINED\" << std::endl"},
+    {"divide_error", "\"DIVIDE BY ZERO\" << std::endl"},
+    {"assignment_error", "\"Illegal variable in assignment\" << std::endl"},
+    {"syntax_error", "\"SYNTAX ERROR\" << std::endl"},
+    {"gosub_error", "\"GOSUB STACK OVERFLOW\" << std::endl"},
+    {"return_error", "\"RETURN WITHOUT GOSUB\" << std::endl"}
+};
+
+static void collect(Expression *exp, std::set<std::string> &vars) {
+    if (exp->getType() == IDENTIFIER) {
+        vars.insert(((IdentifierExp *) exp)->getName());
+    } else if (exp->getType() == NEGATE) {
+        collect(((NegateExp *) exp)->getOperand(), vars);
+    } else if (exp->getType() == COMPOUND) {
+        collect(((CompoundExp *) exp)->getLHS(), vars);
+        collect(((CompoundExp *) exp)->getRHS(), vars);
+    }
+}
+
+/*
+ * Implementation notes: compileExp
+ * --------------------------------
+ * Writes the statements that compute exp and returns a C++ expression
+ * for its value that has no side effects: a literal or a temporary.
+ * The smallest int has no literal of type int in C++, so a constant
+ * with that value, which folding can produce, is written as a
+ * subtraction.  A division by the literal 0 jumps straight to the
+ * error, since compilers warn about the division itself.
+ */
+
+static std::string compileExp(Expression *exp, std::ostream &out, int &temps,
+                              std::set<std::string> &errors) {
+    if (exp->getType() == CONSTANT) {
+        int value = ((ConstantExp *) exp)->getValue();
+        if (value == INT_MIN) return "(" + integerToString(value + 1) + " - 1)";
+        return "(" + exp->toString() + ")";
+    }
+    std::string temp = "t" + integerToString(temps++);
+    if (exp->getType() == IDENTIFIER) {
+        std::string name = ((IdentifierExp *) exp)->getName();
+        out << "        if (!d_" << name << ") goto undefined_error;\n";
+        errors.insert("undefined_error");
+        out << "        int " << temp << " = v_" << name << ";\n";
+        return temp;
+    }
+    if (exp->getType() == NEGATE) {
+        std::string value = compileExp(((NegateExp *) exp)->getOperand(), out, temps, errors);
+        out << "        int " << temp << " = 0 - " << value << ";\n";
+        return temp;
+    }
+    auto *compound = (CompoundExp *) exp;
+    Operator op = compound->getOp();
+    Expression *lhs = compound->getLHS();
+    if (op == ASSIGN_OP) {
+        if (lhs->getType() != IDENTIFIER) {
+            out << "        goto assignment_error;\n";
+            errors.insert("assignment_error");
+            return "(0)";
+        }
+        if (lhs->toString() == "LET") {
+            out << "        goto syntax_error;\n";
+            errors.insert("syntax_error");
+            return "(0)";
+        }
+        std::string name = ((IdentifierExp *) lhs)->getName();
+        std::string value = compileExp(compound->getRHS(), out, temps, errors);
+        out << "        v_" << name << " = " << value << ";\n";
+        out << "        d_" << name << " = true;\n";
+        return value;
+    }
+    std::string left = compileExp(lhs, out, temps, errors);
+    std::string right = compileExp(compound->getRHS(), out, temps, errors);
+    if (op == DIV_OP) {
+        errors.insert("divide_error");
+        if (right == "(0)") {
+            out << "        (void) " << left << ";\n";
+            out << "        goto divide_error;\n";
+            return "(0)";
+        }
+        out << "        if (" << right << " == 0) goto divide_error;\n";
+    }
+    out << "        int " << temp << " = " << left << " " << operatorToString(op) << " " << right << ";\n";
+    return temp;
+}
+
+static std::string target(Program &program, int lineNumber, std::set<std::string> &errors) {
+    if (program.getParsedStatement(lineNumber) == nullptr) {
+        errors.insert("line_error");
+        return "line_error";
+    }
+    return "L" + integerToString(lineNumber);
+}
+
+/*
+ * Implementation notes: compileStatement
+ * --------------------------------------
+ * nextLine is the line that follows stmt, or -1 if there is none.  A
+ * GOSUB pushes it onto a fixed array of MAX_GOSUB_DEPTH entries, and
+ * RETURN jumps to a switch at the end of main that pops it and goes to
+ * its label; a GOSUB on the last line returns past the end of main.
+ */
+
+static void compileStatement(Program &program, Statement *stmt, int nextLine, std::ostream &out,
+                             std::set<std::string> &errors) {
+    int temps = 0;
+    switch (stmt->getType()) {
+        case REM_STMT:
+            break;
+        case LET_STMT: {
+            auto *let = (LetStmt *) stmt;
+            std::string value = compileExp(let->getExp(), out, temps, errors);
+            out << "        v_" << let->getVar() << " = " << value << ";\n";
+            out << "        d_" << let->getVar() << " = true;\n";
+            break;
+        }
+        case PRINT_STMT: {
+            std::string value = compileExp(((PrintStmt *) stmt)->getExp(), out, temps, errors);
+            out << "        std::cout << " << value << " << '\\n';\n";
+            break;
+        }
+        case INPUT_STMT: {
+            std::string var = ((InputStmt *) stmt)->getVar();
+            out << "        v_" << var << " = readInputValue();\n";
+            out << "        d_" << var << " = true;\n";
+            break;
+        }
+        case END_STMT:
+            out << "        return 0;\n";
+            break;
+        case GOTO_STMT:
+            out << "        goto " << target(program, ((GotoStmt *) stmt)->getLineNumber(), errors) << ";\n";
+            break;
+        case GOSUB_STMT:
+            out << "        if (depth == " << MAX_GOSUB_DEPTH << ") goto gosub_error;\n";
+            errors.insert("gosub_error");
+            out << "        returns[depth++] = " << nextLine << ";\n";
+            out << "        goto " << target(program, ((GosubStmt *) stmt)->getLineNumber(), errors) << ";\n";
+            break;
+        case RETURN_STMT:
+            out << "        goto return_dispatch;\n";
+            break;
+        case IF_STMT: {
+            auto *ifStmt = (IfStmt *) stmt;
+            std::string left = compileExp(ifStmt->getLHS(), out, temps, errors);
+            std::string right = compileExp(ifStmt->getRHS(), out, temps, errors);
+            std::string op = ifStmt->getComparison() == EQ_CMP ? "==" : ifStmt->getOp();
+            out << "        if (" << left << " " << op << " " << right << ") goto "
+                << target(program, ifStmt->getLineNumber(), errors) << ";\n";
+            break;
+        }
+    }
+}
+
+/*
+ * Implementation notes: emitCpp
+ * -----------------------------
+ * Only the lines that can be reached are emitted, and only those that
+ * are jumped to or returned to get a label.  The source of each line is
+ * copied into a comment above its code.  Backslashes are replaced
+ * there, since one at the end of a line would splice the following
+ * line of code into the comment.
+ */
+
+void emitCpp(Program &program, std::ostream &out) {
+    std::set<std::string> vars;
+    std::set<int> returnLines;
+    std::set<int> labels;
+    std::set<std::string> errors;
+    bool input = false;
+    bool subroutines = false;
+    bool dispatch = false;
+    std::vector<BasicBlock> &blocks = program.getControlFlowGraph().getBlocks();
+    for (BasicBlock &block : blocks) {
+        for (Statement *stmt : block.statements) {
+            switch (stmt->getType()) {
+                case LET_STMT:
+                    vars.insert(((LetStmt *) stmt)->getVar());
+                    collect(((LetStmt *) stmt)->getExp(), vars);
+                    break;
+                case PRINT_STMT:
+                    collect(((PrintStmt *) stmt)->getExp(), vars);
+                    break;
+                case INPUT_STMT:
+                    vars.insert(((InputStmt *) stmt)->getVar());
+                    input = true;
+                    break;
+                case IF_STMT:
+                    collect(((IfStmt *) stmt)->getLHS(), vars);
+                    collect(((IfStmt *) stmt)->getRHS(), vars);
+                    break;
+                case GOSUB_STMT:
+                    if (block.nextLine != -1) returnLines.insert(block.nextLine);
+                    subroutines = true;
+                    break;
+                case RETURN_STMT:
+                    subroutines = true;
+                    dispatch = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+        if (block.target != -1) labels.insert(block.targetLine);
+    }
+    if (dispatch) labels.insert(returnLines.begin(), returnLines.end());
+    out << PROLOGUE;
+    if (input) out << INPUT_FUNCTION;
+    out << "int main() {\n";
+    for (const std::string &var : vars) {
+        out << "    [[maybe_unused]] int v_" << var << " = 0;\n";
+        out << "    [[maybe_unused]] bool d_" << var << " = false;\n";
+    }
+    if (subroutines) {
+        out << "    [[maybe_unused]] static int returns[" << std::max(MAX_GOSUB_DEPTH, 1) << "];\n";
+        out << "    int depth = 0;\n";
+    }
+    for (BasicBlock &block : blocks) {
+        for (size_t i = 0; i < block.lines.size(); i++) {
+            std::string source = program.getSourceLine(block.lines[i]);
+            for (char &ch : source) {
+                if (ch == '\\') ch = '/';
+            }
+            out << "    // " << source << "\n";
+            if (labels.count(block.lines[i]) != 0) out << "L" << block.lines[i] << ":\n";
+            out << "    {\n";
+            int nextLine = (i + 1 < block.lines.size()) ? block.lines[i + 1] : block.nextLine;
+            compileStatement(program, block.statements[i], nextLine, out, errors);
+            out << "    }\n";
+        }
+    }
+    out << "    return 0;\n";
+    if (dispatch) {
+        out << "return_dispatch:\n";
+        out << "    if (depth == 0) goto return_error;\n";
+        out << "    switch (returns[--depth]) {\n";
+        for (int line : returnLines) out << "        case " << line << ": goto L" << line << ";\n";
+        out << "    }\n";
+        out << "    return 0;\n";
+        errors.insert("return_error");
+    }
+    for (const ErrorLabel &entry : ERROR_LABELS) {
+        if (errors.count(entry.label) == 0) continue;
+        out << entry.label << ":\n";
+        out << "    std::cout << " << entry.output << ";\n";
+        out << "    return 0;\n";
+    }
+    out << "}\n";
+}
@@ -0,0 +1,33 @@
+/*
+ * File: transpiler.h
+ * ------------------
+ * This interface exports emitCpp, which translates a BASIC program into
+ * a standalone C++ translation unit.  It backs the command line
+ *
+ *     code --emit-cpp prog.bas > prog.cpp
+ *
+ * after which the output can be built with any C++ compiler.
+ */
+
+#ifndef _transpiler_h
+#define _transpiler_h
+
+#include <iostream>
+#include "program.hpp"
+
+/*
+ * Function: emitCpp
+ * Usage: emitCpp(program, out);
+ * -----------------------------
+ * Writes to out a C++ program whose main behaves like RUN on program
+ * from a fresh state.  Each line becomes a block, labelled if some
+ * GOTO, IF or RETURN can reach it, GOTO and IF become gotos and each
+ * variable becomes a local together with a flag that records whether
+ * it has been defined.  GOSUB and RETURN use an array of return lines
+ * as their stack.  Errors print the same messages as the interpreter
+ * and end the program.
+ */
+
+void emitCpp(Program &program, std::ostream &out);
+
+#endif